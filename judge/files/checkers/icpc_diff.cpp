@@ -0,0 +1,12 @@
+// ANA Online Judge — default checker ("icpc_diff").
+// Token-by-token whitespace-insensitive comparison of participant
+// output vs. author output. Matches the project's historical default
+// judging behavior used before the workshop system existed.
+#include "testlib.h"
+
+int main(int argc, char *argv[]) {
+    setName("ICPC-style token compare (whitespace-insensitive)");
+    registerTestlibStream(argc, argv);
+
+    testlib::compare<testlib::Tokens, testlib::CaseSensitive, testlib::Strings, testlib::RejectTrailing>(ans, ouf);
+}
@@ -0,0 +1,14 @@
+// testlib rcmp4 — compares two sequences of floating-point numbers
+// with max(absolute, relative) error at most 1e-4.
+// Source adapted from the canonical testlib checkers distribution
+// (https://github.com/MikeMirzayanov/testlib/blob/master/checkers/rcmp4.cpp).
+#include "testlib.h"
+
+const double EPS = 1E-4;
+
+int main(int argc, char *argv[]) {
+    setName("compare two sequences of doubles, max absolute or relative error = %.10f", EPS);
+    registerTestlibStream(argc, argv);
+
+    testlib::compare<testlib::Words, testlib::CaseSensitive, testlib::Doubles<4>, testlib::DefaultTrailing>(ans, ouf);
+}
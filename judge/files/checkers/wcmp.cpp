@@ -0,0 +1,11 @@
+// testlib wcmp — compares sequences of tokens (default whitespace).
+// Source adapted from the canonical testlib checkers distribution
+// (https://github.com/MikeMirzayanov/testlib/blob/master/checkers/wcmp.cpp).
+#include "testlib.h"
+
+int main(int argc, char *argv[]) {
+    setName("compare sequences of tokens");
+    registerTestlibStream(argc, argv);
+
+    testlib::compare<testlib::Words, testlib::CaseSensitive, testlib::Strings, testlib::ReportTrailing>(ans, ouf);
+}
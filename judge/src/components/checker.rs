@@ -2,15 +2,19 @@
 //!
 //! This module handles running checkers for special judge problems:
 //! - C++ testlib.h-based checkers (compiled binary)
+//! - Streaming C++ checkers (`registerTestlibStream`) that run alongside the user program
+//! - Server C++ checkers (`registerTestlibServer`) kept alive for all testcases of a submission
 //! - Python checkers (aoj_checker SDK)
 
 use anyhow::{Context, Result};
 use std::path::{Path, PathBuf};
 use tracing::{debug, info, warn};
 
+use super::testlib_profile::{self, TestlibProfile};
 use crate::core::verdict::Verdict;
 use crate::engine::compiler::CheckerCompiler;
-use crate::engine::executer::{ExecutionLimits, ExecutionSpec, ExecutionStatus};
+use crate::engine::executer::{next_box_id, ExecutionLimits, ExecutionSpec, ExecutionStatus};
+use crate::engine::sandbox::{is_cgroups_available, link_or_copy, IsolateBox, Limits};
 use crate::infra::storage::StorageClient;
 
 /// Result of running a checker
@@ -19,6 +23,8 @@ pub struct CheckerResult {
     pub verdict: Verdict,
     /// Checker stderr output (messages from checker for admin visibility)
     pub checker_message: Option<String>,
+    /// testlib self-profiling record, when `TESTLIB_PROFILE` is enabled
+    pub profile: Option<TestlibProfile>,
 }
 
 /// testlib.h exit codes
@@ -29,9 +35,10 @@ mod testlib_exit_codes {
     pub const PRESENTATION_ERROR: i32 = 2; // _pe (treated as WA in most systems)
     pub const FAIL: i32 = 3; // _fail (checker bug or internal error)
     pub const DIRT: i32 = 4; // _dirt (extra output in user file)
-    #[allow(dead_code)]
-    pub const POINTS: i32 = 5; // _points (partial scoring - not commonly used)
+    pub const POINTS: i32 = 7; // _points (quitp, POINTS_EXIT_CODE)
     pub const UNEXPECTED_EOF: i32 = 8; // _unexpected_eof
+    pub const PC_BASE: i32 = 50; // _pc(0), _pc(n) exits with PC_BASE_EXIT_CODE + n
+    pub const PC_MAX: i32 = 150; // _pc(100)
 }
 
 /// Convert testlib/Python checker exit code to verdict
@@ -43,6 +50,8 @@ fn exit_code_to_verdict(exit_code: i32) -> Verdict {
         testlib_exit_codes::FAIL => Verdict::Fail,
         testlib_exit_codes::DIRT => Verdict::WrongAnswer,
         testlib_exit_codes::UNEXPECTED_EOF => Verdict::WrongAnswer,
+        testlib_exit_codes::POINTS => Verdict::Partial,
+        testlib_exit_codes::PC_BASE..=testlib_exit_codes::PC_MAX => Verdict::Partial,
         _ => {
             warn!("Unknown checker exit code: {}", exit_code);
             if exit_code < 0 || exit_code > 127 {
@@ -54,6 +63,26 @@ fn exit_code_to_verdict(exit_code: i32) -> Verdict {
     }
 }
 
+/// Fraction of the testcase score a `Partial` checker verdict awards, read from
+/// the verdict line testlib starts the checker message with:
+/// - `points <p> ...` (`quitp(p)`): p is always the fraction itself, whatever
+///   the testcase's score (`quitp(0.4)` on a 10-point testcase gives 4 points)
+/// - `partially correct (<n>) ...` (`quitf(_pc(n), ...)`): n percent
+///
+/// None when the message has neither form or the credit is outside of [0, 1],
+/// e.g. `quitp(40)`.
+pub fn partial_credit(checker_message: Option<&str>) -> Option<f64> {
+    let message = checker_message?.trim_start();
+    let credit = if let Some(rest) = message.strip_prefix("points ") {
+        rest.split_whitespace().next()?.parse::<f64>().ok()?
+    } else if let Some(rest) = message.strip_prefix("partially correct (") {
+        rest.split(')').next()?.parse::<i32>().ok()? as f64 / 100.0
+    } else {
+        return None;
+    };
+    (0.0..=1.0).contains(&credit).then_some(credit)
+}
+
 /// Run a testlib.h-based checker (compiled C++ binary)
 ///
 /// Arguments to checker: <input_file> <user_output_file> <expected_answer_file>
@@ -73,16 +102,17 @@ pub async fn run_checker(
     let temp_dir = tempfile::tempdir()?;
     let work_dir = temp_dir.path();
 
-    // Copy necessary files to the temp directory with standard names
+    // Stage necessary files in the temp directory with standard names; hard links,
+    // so neither this nor staging into the box copies the test data
     let checker_bin = "checker";
     let input_name = "input.txt";
     let output_name = "output.txt";
     let answer_name = "answer.txt";
 
-    tokio::fs::copy(checker_path, work_dir.join(checker_bin)).await?;
-    tokio::fs::copy(input_path, work_dir.join(input_name)).await?;
-    tokio::fs::copy(user_output_path, work_dir.join(output_name)).await?;
-    tokio::fs::copy(answer_path, work_dir.join(answer_name)).await?;
+    link_or_copy(checker_path, &work_dir.join(checker_bin)).await?;
+    link_or_copy(input_path, &work_dir.join(input_name)).await?;
+    link_or_copy(user_output_path, &work_dir.join(output_name)).await?;
+    link_or_copy(answer_path, &work_dir.join(answer_name)).await?;
 
     // Build execution spec for sandboxed checker
     let spec = ExecutionSpec::new(work_dir)
@@ -96,7 +126,8 @@ pub async fn run_checker(
             // Use at least 10s as suggested by the user
             time_ms: (timeout_secs * 1000).max(10_000) as u32,
             memory_mb: 1024,
-        });
+        })
+        .with_env_vars(testlib_profile::env_vars());
 
     let result = crate::engine::executer::execute_sandboxed(&spec)
         .await
@@ -112,15 +143,17 @@ pub async fn run_checker(
     );
 
     let verdict = exit_code_to_verdict(result.exit_code());
-    let checker_message = if result.stderr.trim().is_empty() {
+    let (stderr, profile) = testlib_profile::split_testlib_profile(&result.stderr);
+    let checker_message = if stderr.trim().is_empty() {
         None
     } else {
-        Some(result.stderr.chars().take(4096).collect())
+        Some(stderr.chars().take(4096).collect())
     };
 
     Ok(CheckerResult {
         verdict,
         checker_message,
+        profile,
     })
 }
 
@@ -227,6 +260,7 @@ pub async fn run_python_checker(
     Ok(CheckerResult {
         verdict,
         checker_message,
+        profile: None,
     })
 }
 
@@ -363,6 +397,465 @@ pub async fn run_interactive_checker(
     })
 }
 
+/// Result of running a streaming checker
+#[derive(Debug)]
+pub struct StreamingCheckerResult {
+    pub verdict: Verdict,
+    pub user_time_ms: u32,
+    pub user_memory_kb: u32,
+    /// Leading part of the user output
+    pub output_preview: Option<String>,
+    pub checker_message: Option<String>,
+    /// testlib self-profiling record, when `TESTLIB_PROFILE` is enabled
+    pub profile: Option<TestlibProfile>,
+}
+
+/// Run a streaming testlib.h checker alongside a user program.
+///
+/// The user output is piped into the checker (`./checker input.txt - answer.txt`)
+/// instead of being written to a file first. A checker rejecting the output (see
+/// `is_rejecting_checker_status`) ends the run at once, so a wrong answer does not
+/// keep running until the time limit. Any other early exit waits for the user
+/// program, whose TLE / MLE / RE still comes first. The input and answer files
+/// are linked into the checker box, the user program's stdin is fed from the
+/// input file.
+pub async fn run_streaming_checker(
+    checker_path: &Path,
+    input_path: &Path,
+    answer_path: &Path,
+    user_work_dir: &Path,
+    user_command: &[String],
+    user_limits: &ExecutionLimits,
+    timeout_secs: u64,
+) -> Result<StreamingCheckerResult> {
+    info!("Running streaming checker: {:?}", checker_path);
+
+    let temp_dir = tempfile::tempdir()?;
+    let work_dir = temp_dir.path();
+
+    let checker_bin = "checker";
+    let input_name = "input.txt";
+    let answer_name = "answer.txt";
+
+    link_or_copy(checker_path, &work_dir.join(checker_bin)).await?;
+    link_or_copy(input_path, &work_dir.join(input_name)).await?;
+    link_or_copy(answer_path, &work_dir.join(answer_name)).await?;
+
+    let checker_spec = ExecutionSpec::new(work_dir)
+        .with_command([
+            format!("./{}", checker_bin),
+            input_name.to_string(),
+            "-".to_string(),
+            answer_name.to_string(),
+        ])
+        .with_limits(ExecutionLimits {
+            time_ms: (timeout_secs * 1000).max(10_000) as u32,
+            memory_mb: 1024,
+        })
+        .with_env_vars(testlib_profile::env_vars());
+
+    let user_spec = ExecutionSpec::new(user_work_dir)
+        .with_command(user_command.iter().map(|s| s.as_str()))
+        .with_limits(user_limits.clone());
+
+    // Same overall budget as interactive mode: user wall time vs checker timeout, plus buffer
+    let user_wall_secs = (user_limits.time_ms as u64 * 2 / 1000) + 2;
+    let overall_timeout = timeout_secs.max(user_wall_secs) + 5;
+
+    let outcome = crate::engine::executer::execute_streaming(
+        &user_spec,
+        input_path,
+        &checker_spec,
+        overall_timeout,
+        is_rejecting_checker_status,
+    )
+    .await
+    .context("Failed to run streaming checker")?;
+
+    debug!(
+        "Streaming result: user_status={:?}, user_time={}ms, user_mem={}kb, \
+         checker_status={:?}, early={}, output_limit={}, timed_out={}",
+        outcome.user_status,
+        outcome.user_time_ms,
+        outcome.user_memory_kb,
+        outcome.checker_status,
+        outcome.checker_finished_early,
+        outcome.output_limit_exceeded,
+        outcome.timed_out,
+    );
+
+    let (checker_stderr, profile) = testlib_profile::split_testlib_profile(&outcome.checker_stderr);
+    let checker_verdict = || {
+        let code = match outcome.checker_status {
+            ExecutionStatus::Exited(code) => code,
+            _ => -1,
+        };
+        let msg: Option<String> = if checker_stderr.trim().is_empty() {
+            None
+        } else {
+            Some(checker_stderr.chars().take(4096).collect())
+        };
+        (exit_code_to_verdict(code), msg)
+    };
+
+    let (verdict, checker_message) = if outcome.timed_out {
+        (
+            Verdict::SystemError,
+            Some("Streaming execution timed out".to_string()),
+        )
+    } else if outcome.output_limit_exceeded {
+        // Same outcome as hitting the sandbox file size limit
+        (Verdict::RuntimeError, None)
+    } else if outcome.checker_finished_early && is_rejecting_checker_status(&outcome.checker_status)
+    {
+        // Checker rejected the output before the user program finished writing it
+        checker_verdict()
+    } else {
+        match outcome.user_status {
+            ExecutionStatus::TimeLimitExceeded => (Verdict::TimeLimitExceeded, None),
+            ExecutionStatus::MemoryLimitExceeded => (Verdict::MemoryLimitExceeded, None),
+            ExecutionStatus::SystemError => (Verdict::SystemError, None),
+            ExecutionStatus::Exited(0) => checker_verdict(),
+            ExecutionStatus::Signaled(_) | ExecutionStatus::Exited(_) => {
+                (Verdict::RuntimeError, None)
+            }
+        }
+    };
+
+    let output_preview = if outcome.output_preview.is_empty() {
+        None
+    } else {
+        Some(outcome.output_preview)
+    };
+
+    Ok(StreamingCheckerResult {
+        verdict,
+        user_time_ms: outcome.user_time_ms,
+        user_memory_kb: outcome.user_memory_kb,
+        output_preview,
+        checker_message,
+        profile,
+    })
+}
+
+/// Whether a checker status is a verdict rejecting the output (WA / PE / FAIL).
+/// Only these are final when a streaming checker exits before the user program:
+/// an accepting checker may not have read the whole output yet.
+fn is_rejecting_checker_status(status: &ExecutionStatus) -> bool {
+    match status {
+        ExecutionStatus::Exited(code) => matches!(
+            exit_code_to_verdict(*code),
+            Verdict::WrongAnswer | Verdict::PresentationError | Verdict::Fail
+        ),
+        _ => false,
+    }
+}
+
+/// Running checker server process and its isolate box
+struct CheckerServerProcess {
+    isolate_box: IsolateBox,
+    child: tokio::process::Child,
+    stdin: tokio::process::ChildStdin,
+    stdout: tokio::io::BufReader<tokio::process::ChildStdout>,
+    meta_file: String,
+}
+
+impl CheckerServerProcess {
+    /// Close the control pipe, wait for the checker and clean up its box
+    async fn stop(mut self) {
+        drop(self.stdin);
+        let wait = tokio::time::timeout(std::time::Duration::from_secs(5), self.child.wait());
+        if wait.await.is_err() {
+            let _ = self.child.kill().await;
+            let _ = self.child.wait().await;
+        }
+        let _ = self.isolate_box.read_piped_results(&self.meta_file).await;
+        let _ = self.isolate_box.cleanup().await;
+    }
+}
+
+/// One persistent testlib.h checker process for all testcases of a submission.
+///
+/// The checker (`registerTestlibServer`) is started lazily in its own isolate box.
+/// For every testcase the files are written straight into that box and their names
+/// are sent over stdin; the checker answers with a `<exit-code> <message>` line.
+/// This skips box setup, the binary copy and process startup for each testcase.
+pub struct CheckerServer {
+    checker_path: PathBuf,
+    timeout_secs: u64,
+    /// CPU time budget of the whole server (all testcases together)
+    time_ms: u32,
+    process: tokio::sync::Mutex<Option<CheckerServerProcess>>,
+}
+
+impl CheckerServer {
+    pub fn new(checker_path: PathBuf, testcase_count: usize, timeout_secs: u64) -> Self {
+        let per_test_ms = (timeout_secs * 1000).max(10_000);
+        let time_ms = per_test_ms
+            .saturating_mul(testcase_count.max(1) as u64)
+            .min(u32::MAX as u64 / 4) as u32;
+        Self {
+            checker_path,
+            timeout_secs,
+            time_ms,
+            process: tokio::sync::Mutex::new(None),
+        }
+    }
+
+    async fn start(&self) -> Result<CheckerServerProcess> {
+        info!("Starting checker server: {:?}", self.checker_path);
+
+        if !is_cgroups_available().await {
+            anyhow::bail!("Cgroup support is required for sandboxed execution");
+        }
+
+        let isolate_box = IsolateBox::new(next_box_id(), true).await?;
+        tokio::fs::copy(
+            &self.checker_path,
+            Path::new(&isolate_box.work_dir()).join("checker"),
+        )
+        .await?;
+
+        let limits = Limits {
+            time_ms: self.time_ms,
+            memory_mb: 1024,
+            ..Limits::default()
+        };
+        let (mut child, meta_file) = isolate_box
+            .spawn_piped(
+                &["./checker".to_string()],
+                &limits,
+                &testlib_profile::env_vars(),
+            )
+            .await?;
+
+        let stdin = child.stdin.take().unwrap();
+        let stdout = tokio::io::BufReader::new(child.stdout.take().unwrap());
+        Ok(CheckerServerProcess {
+            isolate_box,
+            child,
+            stdin,
+            stdout,
+            meta_file,
+        })
+    }
+
+    /// Check one testcase
+    pub async fn check(&self, input: &Path, output: &[u8], answer: &[u8]) -> Result<CheckerResult> {
+        use tokio::io::{AsyncBufReadExt, AsyncWriteExt};
+
+        let mut guard = self.process.lock().await;
+        if guard.is_none() {
+            *guard = Some(self.start().await?);
+        }
+        let process = guard.as_mut().unwrap();
+
+        let work_dir = PathBuf::from(process.isolate_box.work_dir());
+        tokio::fs::copy(input, work_dir.join("input.txt")).await?;
+        tokio::fs::write(work_dir.join("output.txt"), output).await?;
+        tokio::fs::write(work_dir.join("answer.txt"), answer).await?;
+
+        let exchange = async {
+            process
+                .stdin
+                .write_all(b"input.txt\noutput.txt\nanswer.txt\n")
+                .await?;
+            process.stdin.flush().await?;
+            let mut line = String::new();
+            process.stdout.read_line(&mut line).await?;
+            anyhow::Ok(line)
+        };
+        let timeout = std::time::Duration::from_secs(self.timeout_secs.max(10));
+        let line = match tokio::time::timeout(timeout, exchange).await {
+            Ok(Ok(line)) if !line.is_empty() => line,
+            result => {
+                // The server is gone or stuck: restart it for the next testcase
+                if let Some(process) = guard.take() {
+                    process.stop().await;
+                }
+                return match result {
+                    Err(_) => Ok(CheckerResult {
+                        verdict: Verdict::SystemError,
+                        checker_message: Some("Checker timed out".to_string()),
+                        profile: None,
+                    }),
+                    Ok(Err(e)) => Err(e).context("Checker server I/O failed"),
+                    Ok(Ok(_)) => Err(anyhow::anyhow!("Checker server exited unexpectedly")),
+                };
+            }
+        };
+
+        debug!("Checker server reply: {}", line.trim_end());
+
+        let (code, message) = line
+            .trim_end()
+            .split_once(' ')
+            .unwrap_or((line.trim_end(), ""));
+        let exit_code: i32 = code
+            .parse()
+            .with_context(|| format!("Malformed checker server reply: {:?}", line))?;
+        let (message, profile) = testlib_profile::split_testlib_profile(message);
+        let checker_message = if message.trim().is_empty() {
+            None
+        } else {
+            Some(message.chars().take(4096).collect())
+        };
+
+        Ok(CheckerResult {
+            verdict: exit_code_to_verdict(exit_code),
+            checker_message,
+            profile,
+        })
+    }
+
+    /// Stop the server process (if it was started)
+    pub async fn shutdown(&self) {
+        if let Some(process) = self.process.lock().await.take() {
+            process.stop().await;
+        }
+    }
+}
+
+/// How a C++ checker is run, by the testlib registration its `main` calls
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum CheckerMode {
+    /// `registerTestlibCmd`: one process per testcase over files
+    Cmd,
+    /// `registerTestlibStream`: reads the output from stdin (see `run_streaming_checker`)
+    Stream,
+    /// `registerTestlibServer`: all testcases from one process (see `CheckerServer`)
+    Server,
+}
+
+/// Determine the mode of a C++ checker source from its testlib registration call.
+///
+/// Only real calls count: comments, string / char literals and preprocessor lines
+/// are stripped first, and the name must be followed by `(`. A source calling
+/// several registrations (e.g. under `#ifdef`) is ambiguous and runs as `Cmd`:
+/// stream and server checkers given file arguments behave like `registerTestlibCmd`.
+pub fn checker_mode(source: &str) -> CheckerMode {
+    let code = strip_comments_and_literals(source);
+    let calls: Vec<&str> = [
+        "registerTestlibCmd",
+        "registerTestlibStream",
+        "registerTestlibServer",
+    ]
+    .into_iter()
+    .filter(|name| calls_function(&code, name))
+    .collect();
+    match calls.as_slice() {
+        ["registerTestlibStream"] => CheckerMode::Stream,
+        ["registerTestlibServer"] => CheckerMode::Server,
+        [] | ["registerTestlibCmd"] => CheckerMode::Cmd,
+        _ => {
+            warn!(
+                "Checker calls several testlib registrations ({}), running it per testcase",
+                calls.join(", ")
+            );
+            CheckerMode::Cmd
+        }
+    }
+}
+
+fn is_identifier_char(c: char) -> bool {
+    c.is_ascii_alphanumeric() || c == '_'
+}
+
+/// Whether `code` has `name` as a whole identifier followed by `(`
+fn calls_function(code: &str, name: &str) -> bool {
+    code.match_indices(name).any(|(pos, _)| {
+        let before = code[..pos].chars().next_back();
+        let after = code[pos + name.len()..].trim_start();
+        !before.is_some_and(is_identifier_char) && after.starts_with('(')
+    })
+}
+
+/// C++ source with comments, string / char literals and preprocessor directives
+/// replaced by spaces (newlines are kept)
+fn strip_comments_and_literals(source: &str) -> String {
+    let chars: Vec<char> = source.chars().collect();
+    let mut out = String::with_capacity(source.len());
+    let blank = |out: &mut String, c: char| out.push(if c == '\n' { '\n' } else { ' ' });
+    let mut line_start = true;
+    let mut i = 0;
+    while i < chars.len() {
+        let c = chars[i];
+        let next = chars.get(i + 1).copied();
+        let prev = if i > 0 { Some(chars[i - 1]) } else { None };
+
+        let end = if line_start && c == '#' {
+            // Directive up to the end of line, with backslash continuations
+            let mut j = i;
+            while j < chars.len() && chars[j] != '\n' {
+                j += if chars[j] == '\\' { 2 } else { 1 };
+            }
+            j.min(chars.len())
+        } else if c == '/' && next == Some('/') {
+            let mut j = i;
+            while j < chars.len() && chars[j] != '\n' {
+                j += 1;
+            }
+            j
+        } else if c == '/' && next == Some('*') {
+            let mut j = i + 2;
+            while j < chars.len() && !(chars[j] == '*' && chars.get(j + 1) == Some(&'/')) {
+                j += 1;
+            }
+            (j + 2).min(chars.len())
+        } else if c == 'R' && next == Some('"') {
+            // Raw string: R"delim( ... )delim"
+            let delim: String = chars[i + 2..].iter().take_while(|&&d| d != '(').collect();
+            let close: Vec<char> = format!("){}\"", delim).chars().collect();
+            let mut j = i + 2 + delim.len();
+            while j < chars.len() && !chars[j..].starts_with(&close) {
+                j += 1;
+            }
+            (j + close.len()).min(chars.len())
+        } else if c.is_ascii_digit() && !prev.is_some_and(is_identifier_char) {
+            // Number, which may have ' digit separators: kept as it is
+            let mut j = i;
+            while j < chars.len()
+                && (is_identifier_char(chars[j]) || matches!(chars[j], '.' | '\''))
+            {
+                j += 1;
+            }
+            out.extend(&chars[i..j]);
+            line_start = false;
+            i = j;
+            continue;
+        } else if c == '"' || c == '\'' {
+            let mut j = i + 1;
+            while j < chars.len() && chars[j] != c && chars[j] != '\n' {
+                j += if chars[j] == '\\' { 2 } else { 1 };
+            }
+            (j + 1).min(chars.len())
+        } else {
+            out.push(c);
+            if c == '\n' {
+                line_start = true;
+            } else if !c.is_whitespace() {
+                line_start = false;
+            }
+            i += 1;
+            continue;
+        };
+
+        for &skipped in &chars[i..end] {
+            blank(&mut out, skipped);
+        }
+        line_start = end > 0 && chars[end - 1] == '\n';
+        i = end;
+    }
+    out
+}
+
+/// Compiled C++ checker
+#[derive(Debug, Clone)]
+pub struct CppChecker {
+    pub path: PathBuf,
+    pub mode: CheckerMode,
+}
+
 /// Checker manager for handling checker compilation and caching
 pub struct CheckerManager {
     /// Compiler for C++ checkers
@@ -377,21 +870,26 @@ impl CheckerManager {
         }
     }
 
-    /// Get the path to a compiled C++ checker, compiling it if necessary
+    /// Get a compiled C++ checker, compiling it if necessary
     pub async fn get_cpp_checker(
         &self,
         storage: &StorageClient,
         checker_source_path: &str,
         problem_id: i64,
-    ) -> Result<PathBuf> {
+    ) -> Result<CppChecker> {
         // Download source from storage
         info!("Downloading checker source: {}", checker_source_path);
         let source_content = storage.download_string(checker_source_path).await?;
 
         // Compile or get cached
-        self.compiler
-            .get_or_compile(&source_content, problem_id)
-            .await
+        let path = self
+            .compiler
+            .get_or_compile(storage, &source_content, problem_id)
+            .await?;
+        Ok(CppChecker {
+            path,
+            mode: checker_mode(&source_content),
+        })
     }
 
     /// Download a Python checker source from storage
@@ -419,6 +917,43 @@ mod tests {
         assert_eq!(exit_code_to_verdict(2), Verdict::PresentationError);
         assert_eq!(exit_code_to_verdict(3), Verdict::Fail);
         assert_eq!(exit_code_to_verdict(4), Verdict::WrongAnswer);
+        assert_eq!(exit_code_to_verdict(7), Verdict::Partial);
+        assert_eq!(exit_code_to_verdict(50), Verdict::Partial);
+        assert_eq!(exit_code_to_verdict(150), Verdict::Partial);
+        assert_eq!(exit_code_to_verdict(151), Verdict::SystemError);
+    }
+
+    #[test]
+    fn test_partial_credit() {
+        assert_eq!(
+            partial_credit(Some("points 0.25 3 of 12 queries")),
+            Some(0.25)
+        );
+        assert_eq!(partial_credit(Some("points 0.5")), Some(0.5));
+        assert_eq!(partial_credit(Some("points 0")), Some(0.0));
+        assert_eq!(
+            partial_credit(Some("partially correct (30) result=3")),
+            Some(0.3)
+        );
+    }
+
+    #[test]
+    fn test_partial_credit_is_a_fraction_up_to_one() {
+        assert_eq!(partial_credit(Some("points 1")), Some(1.0));
+        assert_eq!(partial_credit(Some("points 0.999")), Some(0.999));
+        assert_eq!(partial_credit(Some("points 1.001")), None);
+        assert_eq!(partial_credit(Some("points 1.5")), None);
+        assert_eq!(partial_credit(Some("points 10")), None);
+    }
+
+    #[test]
+    fn test_partial_credit_rejects_unreadable_or_out_of_range_points() {
+        assert_eq!(partial_credit(Some("points 140")), None);
+        assert_eq!(partial_credit(Some("points -0.5")), None);
+        assert_eq!(partial_credit(Some("points nan")), None);
+        assert_eq!(partial_credit(Some("points points_info=a")), None);
+        assert_eq!(partial_credit(Some("wrong answer 1st words differ")), None);
+        assert_eq!(partial_credit(None), None);
     }
 
     #[test]
@@ -438,4 +973,80 @@ mod tests {
         assert!(is_python_checker("checker.py"));
         assert!(!is_python_checker("checker.py.bak"));
     }
+
+    #[test]
+    fn test_is_rejecting_checker_status() {
+        assert!(is_rejecting_checker_status(&ExecutionStatus::Exited(1)));
+        assert!(is_rejecting_checker_status(&ExecutionStatus::Exited(2)));
+        assert!(is_rejecting_checker_status(&ExecutionStatus::Exited(3)));
+        assert!(!is_rejecting_checker_status(&ExecutionStatus::Exited(0)));
+        assert!(!is_rejecting_checker_status(&ExecutionStatus::Exited(7)));
+        assert!(!is_rejecting_checker_status(&ExecutionStatus::Exited(80)));
+        assert!(!is_rejecting_checker_status(
+            &ExecutionStatus::TimeLimitExceeded
+        ));
+        assert!(!is_rejecting_checker_status(&ExecutionStatus::Signaled(9)));
+    }
+
+    #[test]
+    fn test_checker_mode() {
+        assert_eq!(
+            checker_mode(
+                "int main(int argc, char* argv[]) {\n    registerTestlibServer(argc, argv);"
+            ),
+            CheckerMode::Server
+        );
+        assert_eq!(
+            checker_mode(
+                "int main(int argc, char* argv[]) {\n    registerTestlibStream (argc, argv);"
+            ),
+            CheckerMode::Stream
+        );
+        assert_eq!(
+            checker_mode("int main(int argc, char* argv[]) {\n    registerTestlibCmd(argc, argv);"),
+            CheckerMode::Cmd
+        );
+        assert_eq!(
+            checker_mode("int x = 1'000'000;\nint main() { registerTestlibStream(argc, argv); }"),
+            CheckerMode::Stream
+        );
+    }
+
+    #[test]
+    fn test_checker_mode_ignores_comments_strings_and_directives() {
+        let cmd = "\nint main(int argc, char* argv[]) {\n    registerTestlibCmd(argc, argv);\n}";
+        for noise in [
+            "// registerTestlibStream(argc, argv);",
+            "/* registerTestlibServer(argc, argv); */",
+            "/* multi\n   registerTestlibServer(argc, argv);\n*/",
+            "const char *s = \"registerTestlibStream(argc, argv)\";",
+            "const char *s = R\"x(registerTestlibServer(\"a\"))x\";",
+            "char q = '\"'; // registerTestlibStream(",
+            "#define STREAM registerTestlibStream(argc, argv)",
+            "#define SERVER \\\n    registerTestlibServer(argc, argv)",
+            "void registerTestlibStreamLater(int);",
+            "auto f = &registerTestlibServer;",
+        ] {
+            assert_eq!(
+                checker_mode(&format!("{}{}", noise, cmd)),
+                CheckerMode::Cmd,
+                "{}",
+                noise
+            );
+        }
+    }
+
+    #[test]
+    fn test_checker_mode_with_several_registrations_is_cmd() {
+        assert_eq!(
+            checker_mode(
+                "#ifdef SERVER\n    registerTestlibServer(argc, argv);\n#else\n    registerTestlibStream(argc, argv);\n#endif"
+            ),
+            CheckerMode::Cmd
+        );
+        assert_eq!(
+            checker_mode("registerTestlibCmd(argc, argv); registerTestlibStream(argc, argv);"),
+            CheckerMode::Cmd
+        );
+    }
 }
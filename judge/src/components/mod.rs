@@ -1 +1,2 @@
 pub mod checker;
+pub mod testlib_profile;
@@ -0,0 +1,125 @@
+//! testlib self-profiling records
+//!
+//! With `TESTLIB_PROFILE=1` in its environment a testlib checker or validator ends
+//! its stderr with one line
+//!
+//!   testlib-profile: {"inf": {"bytes": 12, "tokens": 3}, "ouf": {...}, "ans": {...},
+//!                     "refillMs": 0.1, "parseMs": 0.2, "userMs": 0.3, "peakRssKb": 3456}
+//!
+//! A checker server (`registerTestlibServer`) replies with one line per testcase,
+//! so there the record is the end of that line, after a space.
+//!
+//! The judge forwards `TESTLIB_PROFILE` from its own environment, so profiling is
+//! switched on per worker. The record is split off the message (it must not reach
+//! verdict messages shown to users) and logged.
+
+use serde::{Deserialize, Serialize};
+
+/// Marker testlib starts the record line with
+const RECORD_PREFIX: &str = "testlib-profile: ";
+
+/// Environment variable switching testlib profiling on
+const PROFILE_ENV: &str = "TESTLIB_PROFILE";
+
+/// What one stream (inf/ouf/ans) gave to the program
+#[derive(Debug, Clone, Default, PartialEq, Serialize, Deserialize)]
+pub struct StreamProfile {
+    pub bytes: u64,
+    pub tokens: u64,
+}
+
+/// Parsed testlib profile record
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct TestlibProfile {
+    pub inf: StreamProfile,
+    pub ouf: StreamProfile,
+    pub ans: StreamProfile,
+    /// Time spent filling reader buffers from files and pipes
+    #[serde(rename = "refillMs")]
+    pub refill_ms: f64,
+    /// Time spent in read-functions besides refills
+    #[serde(rename = "parseMs")]
+    pub parse_ms: f64,
+    /// The rest: checker/validator logic, comparing spans, output
+    #[serde(rename = "userMs")]
+    pub user_ms: f64,
+    #[serde(rename = "peakRssKb")]
+    pub peak_rss_kb: u64,
+}
+
+/// Environment to pass to a testlib program: `TESTLIB_PROFILE` when the judge has it.
+pub fn env_vars() -> Vec<(String, String)> {
+    match std::env::var(PROFILE_ENV) {
+        Ok(value) if !value.is_empty() && value != "0" => vec![(PROFILE_ENV.to_string(), value)],
+        _ => vec![],
+    }
+}
+
+/// Split the trailing profile record off testlib stderr (or a checker server reply).
+///
+/// Returns the stderr without the record and the parsed record. The record must
+/// start the output or follow a line break or space, and must end it. Output
+/// without a (well-formed) record is returned unchanged.
+pub fn split_testlib_profile(stderr: &str) -> (String, Option<TestlibProfile>) {
+    let trimmed = stderr.trim_end();
+    let Some(pos) = trimmed.rfind(RECORD_PREFIX) else {
+        return (stderr.to_string(), None);
+    };
+    let rest = &trimmed[..pos];
+    if !(rest.is_empty() || rest.ends_with(char::is_whitespace)) {
+        return (stderr.to_string(), None);
+    }
+    match serde_json::from_str(&trimmed[pos + RECORD_PREFIX.len()..]) {
+        Ok(profile) => (rest.trim_end().to_string(), Some(profile)),
+        Err(_) => (stderr.to_string(), None),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const RECORD: &str = r#"testlib-profile: {"inf": {"bytes": 6, "tokens": 1}, "ouf": {"bytes": 93, "tokens": 11}, "ans": {"bytes": 0, "tokens": 0}, "refillMs": 0.000, "parseMs": 0.007, "userMs": 0.122, "peakRssKb": 4004}"#;
+
+    #[test]
+    fn splits_record_after_message() {
+        let stderr = format!("wrong answer 1st words differ\n{}\n", RECORD);
+        let (message, profile) = split_testlib_profile(&stderr);
+        assert_eq!(message, "wrong answer 1st words differ");
+        let profile = profile.unwrap();
+        assert_eq!(profile.ouf.bytes, 93);
+        assert_eq!(profile.ouf.tokens, 11);
+        assert_eq!(profile.peak_rss_kb, 4004);
+        assert!((profile.user_ms - 0.122).abs() < 1e-9);
+    }
+
+    #[test]
+    fn splits_record_without_message() {
+        let (message, profile) = split_testlib_profile(RECORD);
+        assert_eq!(message, "");
+        assert_eq!(profile.unwrap().inf.tokens, 1);
+    }
+
+    #[test]
+    fn splits_record_from_server_reply() {
+        // registerTestlibServer joins the lines of the message with spaces
+        let reply = format!("wrong answer 1st words differ {}", RECORD);
+        let (message, profile) = split_testlib_profile(&reply);
+        assert_eq!(message, "wrong answer 1st words differ");
+        assert_eq!(profile.unwrap().ouf.tokens, 11);
+    }
+
+    #[test]
+    fn keeps_stderr_without_record() {
+        let stderr = "ok 3 tokens\n";
+        assert_eq!(split_testlib_profile(stderr), (stderr.to_string(), None));
+
+        // Only the last line counts, and it must parse
+        let inner = format!("{}\nok 3 tokens", RECORD);
+        assert_eq!(split_testlib_profile(&inner), (inner.clone(), None));
+        let broken = "ok\ntestlib-profile: {";
+        assert_eq!(split_testlib_profile(broken), (broken.to_string(), None));
+        let glued = format!("ok{}", RECORD);
+        assert_eq!(split_testlib_profile(&glued), (glued.clone(), None));
+    }
+}
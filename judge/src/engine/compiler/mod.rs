@@ -9,10 +9,44 @@
 pub mod include_flags;
 
 use anyhow::{Context, Result};
+use sha2::{Digest, Sha256};
 use std::path::{Path, PathBuf};
-use tracing::{debug, info};
+use std::sync::atomic::{AtomicU64, Ordering};
+use tracing::{debug, info, warn};
 
 use crate::engine::executer::{execute_sandboxed, ExecutionLimits, ExecutionSpec, ExecutionStatus};
+use crate::infra::storage::StorageClient;
+
+/// Directory holding the judge's testlib.h and its precompiled header
+/// (built by the Dockerfile with the same flags as [`compile_trusted_cpp`]).
+pub const TESTLIB_PCH_DIR: &str = "/usr/local/include/aoj-testlib";
+
+/// Precompiled testlib include directory, if the image provides one.
+pub fn testlib_pch_dir() -> Option<&'static Path> {
+    let dir = Path::new(TESTLIB_PCH_DIR);
+    if dir.join("testlib.h").is_file() && dir.join("testlib.h.gch").is_file() {
+        Some(dir)
+    } else {
+        None
+    }
+}
+
+/// Whether `content` is exactly the testlib.h the precompiled header was built from.
+///
+/// g++ does not check the header contents against the .gch, so a draft that ships
+/// its own (modified) testlib.h must keep staging it next to the source.
+pub async fn matches_precompiled_testlib(content: &[u8]) -> bool {
+    let Some(dir) = testlib_pch_dir() else {
+        return false;
+    };
+    match tokio::fs::read(dir.join("testlib.h")).await {
+        Ok(bundled) => bundled == content,
+        Err(_) => false,
+    }
+}
+
+/// Compiler and flags used for trusted programs (checkers, validators)
+pub const TRUSTED_CPP_FLAGS: [&str; 3] = ["g++", "-O2", "-std=c++17"];
 
 /// Result of compiling a trusted program (checker/validator)
 #[derive(Debug)]
@@ -36,14 +70,12 @@ pub async fn compile_trusted_cpp(
         .and_then(|n| n.to_str())
         .unwrap_or("output");
 
-    let mut command = vec![
-        "g++".to_string(),
-        "-O2".to_string(),
-        "-std=c++17".to_string(),
+    let mut command: Vec<String> = TRUSTED_CPP_FLAGS.iter().map(|s| s.to_string()).collect();
+    command.extend([
         "-o".to_string(),
         output_filename.to_string(),
         source_filename.to_string(),
-    ];
+    ]);
 
     for include_path in include_paths {
         command.push(format!("-I{}", include_path.display()));
@@ -262,7 +294,15 @@ pub async fn compile_on_host(
     }
 }
 
+/// Directory of checkers compiled into the image (`<name>.cpp` next to its `<name>` binary)
+pub const PREBUILT_CHECKERS_DIR: &str = "files/checkers";
+
 /// Generic compiler for trusted components (checkers, validators)
+///
+/// Binaries are content-addressed by (compiler version, flags, testlib.h, source), so
+/// problems sharing a checker share one binary. Lookup order: local cache, checkers
+/// prebuilt into the image, the shared MinIO cache, and finally a sandboxed compile
+/// whose result is uploaded for the other judge workers.
 pub struct TrustedCompiler {
     /// Name of the component (e.g., "checker", "validator")
     name: String,
@@ -270,80 +310,234 @@ pub struct TrustedCompiler {
     testlib_path: PathBuf,
     /// Local cache directory
     cache_dir: PathBuf,
+    /// Directory of prebuilt binaries to reuse for identical sources
+    prebuilt_dir: PathBuf,
+    /// Compiler version, testlib.h and flags hashed into every cache key
+    key_salt: Vec<u8>,
 }
 
 impl TrustedCompiler {
     pub fn new(name: &str, cache_dir_name: &str) -> Self {
-        let testlib_path = std::env::current_dir()
-            .map(|cwd| cwd.join("files/testlib.h"))
-            .unwrap_or_else(|_| PathBuf::from("files/testlib.h"));
+        let cwd = std::env::current_dir().unwrap_or_default();
+        let testlib_path = cwd.join("files/testlib.h");
 
         // Ensure cache directory exists is handled lazily or here?
         // We'll use /tmp/<cache_dir_name> based on original code
         let cache_dir = PathBuf::from("/tmp").join(cache_dir_name);
 
+        let compiler_version = std::process::Command::new("g++")
+            .arg("-dumpfullversion")
+            .output()
+            .map(|o| o.stdout)
+            .unwrap_or_default();
+        let testlib = std::fs::read(&testlib_path).unwrap_or_default();
+
         Self {
             name: name.to_string(),
             testlib_path,
             cache_dir,
+            prebuilt_dir: cwd.join(PREBUILT_CHECKERS_DIR),
+            key_salt: cache_key_salt(&compiler_version, &testlib),
         }
     }
 
     /// Get the path to a compiled binary, compiling if necessary
-    pub async fn get_or_compile(&self, source_content: &str, problem_id: i64) -> Result<PathBuf> {
-        let comp_dir = self.cache_dir.join(format!("{}_{}", self.name, problem_id));
-        tokio::fs::create_dir_all(&comp_dir).await?;
-
-        let source_filename = format!("{}.cpp", self.name);
-        let source_path = comp_dir.join(&source_filename);
-        let binary_path = comp_dir.join(&self.name);
+    pub async fn get_or_compile(
+        &self,
+        storage: &StorageClient,
+        source_content: &str,
+        problem_id: i64,
+    ) -> Result<PathBuf> {
+        let key = cache_key(&self.key_salt, source_content);
+        let entry_dir = self.cache_dir.join(&key);
+        let binary_path = entry_dir.join(&self.name);
+
+        if binary_path.exists() {
+            debug!(
+                "{} for problem {} found in local cache ({})",
+                self.name,
+                problem_id,
+                &key[..12]
+            );
+            return Ok(binary_path);
+        }
+        tokio::fs::create_dir_all(&entry_dir).await?;
+
+        if let Some(prebuilt) = self.find_prebuilt(source_content).await {
+            info!(
+                "Using prebuilt {} {:?} for problem {}",
+                self.name, prebuilt, problem_id
+            );
+            let bytes = tokio::fs::read(&prebuilt).await?;
+            install_binary(&bytes, &binary_path).await?;
+            return Ok(binary_path);
+        }
 
-        // Check if source has changed or binary doesn't exist
-        let need_compile = if binary_path.exists() && source_path.exists() {
-            let cached_source = tokio::fs::read_to_string(&source_path)
-                .await
-                .unwrap_or_default();
-            if cached_source != source_content {
+        let remote_key = format!("compiled/{}/{}", self.name, key);
+        match storage.download(&remote_key).await {
+            Ok(bytes) => {
                 info!(
-                    "{} source has changed, recompiling for problem {}",
-                    self.name, problem_id
+                    "{} for problem {} restored from shared cache ({})",
+                    self.name, problem_id, remote_key
                 );
-                true
-            } else {
-                debug!(
-                    "{} source unchanged, using cached binary for problem {}",
-                    self.name, problem_id
-                );
-                false
+                install_binary(&bytes, &binary_path).await?;
+                return Ok(binary_path);
             }
-        } else {
-            true
+            Err(e) => debug!("Shared cache miss for {}: {:#}", remote_key, e),
+        }
+
+        // Build in a private directory so concurrent jobs compiling the same
+        // source never observe a partially written binary.
+        let build_dir = self.cache_dir.join(format!(
+            "{}.build.{}",
+            key,
+            std::time::SystemTime::now()
+                .duration_since(std::time::UNIX_EPOCH)
+                .map(|d| d.as_nanos())
+                .unwrap_or(0)
+        ));
+        tokio::fs::create_dir_all(&build_dir).await?;
+        let result = self
+            .compile_into(&build_dir, source_content, problem_id)
+            .await;
+        let built = build_dir.join(&self.name);
+        let installed = match result {
+            Ok(()) => tokio::fs::rename(&built, &binary_path)
+                .await
+                .context("Failed to install compiled binary"),
+            Err(e) => Err(e),
         };
+        let _ = tokio::fs::remove_dir_all(&build_dir).await;
+        installed?;
 
-        if need_compile {
-            tokio::fs::write(&source_path, source_content).await?;
+        info!("{} compiled successfully: {:?}", self.name, binary_path);
 
-            // Stage testlib.h alongside the source so the sandbox box has it
-            // visible on its include path. Per compile_trusted_cpp's contract,
-            // `&[Path::new(".")]` resolves to the box work_dir = comp_dir.
-            if self.testlib_path.exists() {
-                tokio::fs::copy(&self.testlib_path, comp_dir.join("testlib.h")).await?;
+        match tokio::fs::read(&binary_path).await {
+            Ok(bytes) => {
+                if let Err(e) = storage.upload(&remote_key, bytes).await {
+                    warn!("Failed to share compiled {}: {:#}", self.name, e);
+                }
             }
+            Err(e) => warn!("Failed to read compiled {}: {:#}", self.name, e),
+        }
 
-            info!("Compiling {} for problem {}", self.name, problem_id);
-            let result = compile_trusted_cpp(&source_path, &binary_path, &[Path::new(".")]).await?;
+        Ok(binary_path)
+    }
 
-            if !result.success {
-                anyhow::bail!("Failed to compile {}: {}", self.name, result.stderr);
-            }
+    /// Compile `source_content` into `<comp_dir>/<name>`
+    async fn compile_into(
+        &self,
+        comp_dir: &Path,
+        source_content: &str,
+        problem_id: i64,
+    ) -> Result<()> {
+        let source_path = comp_dir.join(format!("{}.cpp", self.name));
+        let binary_path = comp_dir.join(&self.name);
+        tokio::fs::write(&source_path, source_content).await?;
+
+        // Prefer the precompiled testlib.h: it must not be shadowed by a copy
+        // next to the source, since `#include "testlib.h"` searches there first.
+        // Otherwise stage testlib.h alongside the source so the sandbox box has
+        // it visible on its include path. Per compile_trusted_cpp's contract,
+        // `&[Path::new(".")]` resolves to the box work_dir = comp_dir.
+        let mut include_paths = vec![Path::new(".")];
+        if let Some(pch_dir) = testlib_pch_dir() {
+            include_paths.push(pch_dir);
+        } else if self.testlib_path.exists() {
+            tokio::fs::copy(&self.testlib_path, comp_dir.join("testlib.h")).await?;
+        }
 
-            info!("{} compiled successfully: {:?}", self.name, binary_path);
+        info!("Compiling {} for problem {}", self.name, problem_id);
+        let result = compile_trusted_cpp(&source_path, &binary_path, &include_paths).await?;
+
+        if !result.success {
+            anyhow::bail!("Failed to compile {}: {}", self.name, result.stderr);
         }
+        Ok(())
+    }
 
-        Ok(binary_path)
+    /// Prebuilt binary whose source is identical to `source_content` (up to line endings)
+    async fn find_prebuilt(&self, source_content: &str) -> Option<PathBuf> {
+        let wanted = normalize_line_endings(source_content);
+        let mut entries = tokio::fs::read_dir(&self.prebuilt_dir).await.ok()?;
+        while let Ok(Some(entry)) = entries.next_entry().await {
+            let path = entry.path();
+            if path.extension().and_then(|e| e.to_str()) != Some("cpp") {
+                continue;
+            }
+            let binary = path.with_extension("");
+            if !binary.is_file() {
+                continue;
+            }
+            match tokio::fs::read_to_string(&path).await {
+                Ok(source) if normalize_line_endings(&source) == wanted => return Some(binary),
+                _ => {}
+            }
+        }
+        None
     }
 }
 
+/// Sources compare equal whatever line endings they were saved with
+fn normalize_line_endings(source: &str) -> String {
+    source.replace("\r\n", "\n")
+}
+
+/// Cache key salt: everything besides the source that affects the binary
+fn cache_key_salt(compiler_version: &[u8], testlib: &[u8]) -> Vec<u8> {
+    let mut hasher = Sha256::new();
+    hasher.update(b"--COMPILER--\n");
+    hasher.update(compiler_version);
+    hasher.update(b"\n--COMPILE_CMD--\n");
+    for tok in TRUSTED_CPP_FLAGS {
+        hasher.update(tok.as_bytes());
+        hasher.update(b"\0");
+    }
+    hasher.update(b"\n--TESTLIB--\n");
+    hasher.update(testlib);
+    hasher.finalize().to_vec()
+}
+
+/// Content-addressed cache key (hex sha256) of a trusted source
+fn cache_key(salt: &[u8], source_content: &str) -> String {
+    let mut hasher = Sha256::new();
+    hasher.update(salt);
+    hasher.update(b"\n--SOURCE--\n");
+    hasher.update(source_content.as_bytes());
+    format!("{:x}", hasher.finalize())
+}
+
+/// Distinguishes the temp files of concurrent installs in this process
+static INSTALL_COUNTER: AtomicU64 = AtomicU64::new(0);
+
+/// Temp file next to `dest`, unique per process and call
+fn install_temp_path(dest: &Path) -> PathBuf {
+    dest.with_extension(format!(
+        "tmp.{}.{}",
+        std::process::id(),
+        INSTALL_COUNTER.fetch_add(1, Ordering::Relaxed)
+    ))
+}
+
+/// Atomically place an executable at `dest`
+async fn install_binary(bytes: &[u8], dest: &Path) -> Result<()> {
+    use std::os::unix::fs::PermissionsExt;
+
+    let tmp = install_temp_path(dest);
+    let result = async {
+        tokio::fs::write(&tmp, bytes).await?;
+        tokio::fs::set_permissions(&tmp, std::fs::Permissions::from_mode(0o755)).await?;
+        tokio::fs::rename(&tmp, dest)
+            .await
+            .with_context(|| format!("Failed to install binary {:?}", dest))
+    }
+    .await;
+    if result.is_err() {
+        let _ = tokio::fs::remove_file(&tmp).await;
+    }
+    result
+}
+
 /// Manager for checker compilation and caching
 pub struct CheckerCompiler {
     inner: TrustedCompiler,
@@ -356,8 +550,15 @@ impl CheckerCompiler {
         }
     }
 
-    pub async fn get_or_compile(&self, source_content: &str, problem_id: i64) -> Result<PathBuf> {
-        self.inner.get_or_compile(source_content, problem_id).await
+    pub async fn get_or_compile(
+        &self,
+        storage: &StorageClient,
+        source_content: &str,
+        problem_id: i64,
+    ) -> Result<PathBuf> {
+        self.inner
+            .get_or_compile(storage, source_content, problem_id)
+            .await
     }
 }
 
@@ -373,7 +574,103 @@ impl ValidatorCompiler {
         }
     }
 
-    pub async fn get_or_compile(&self, source_content: &str, problem_id: i64) -> Result<PathBuf> {
-        self.inner.get_or_compile(source_content, problem_id).await
+    pub async fn get_or_compile(
+        &self,
+        storage: &StorageClient,
+        source_content: &str,
+        problem_id: i64,
+    ) -> Result<PathBuf> {
+        self.inner
+            .get_or_compile(storage, source_content, problem_id)
+            .await
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn cache_key_is_shared_by_identical_sources() {
+        let salt = cache_key_salt(b"12.2.0", b"testlib");
+        assert_eq!(
+            cache_key(&salt, "int main(){}"),
+            cache_key(&salt, "int main(){}")
+        );
+        assert_ne!(
+            cache_key(&salt, "int main(){}"),
+            cache_key(&salt, "int main(){ }")
+        );
+    }
+
+    #[test]
+    fn install_temp_paths_are_unique() {
+        let dest = Path::new("/tmp/checker_cache/abc");
+        assert_ne!(install_temp_path(dest), install_temp_path(dest));
+    }
+
+    #[test]
+    fn line_endings_are_normalized_on_both_sides() {
+        assert_eq!(
+            normalize_line_endings("int main() {\r\n}\r\n"),
+            normalize_line_endings("int main() {\n}\n")
+        );
+    }
+
+    /// judge/files keeps copies of the workshop's bundled testlib.h, SDK and checkers
+    /// (the judge image is built from judge/ alone). find_prebuilt only matches
+    /// identical sources, so a drifted copy would silently compile every checker.
+    #[test]
+    fn bundled_copies_match_the_workshop_sources() {
+        let judge_files = Path::new(env!("CARGO_MANIFEST_DIR")).join("files");
+        let bundled = Path::new(env!("CARGO_MANIFEST_DIR")).join("../web/src/lib/workshop/bundled");
+
+        let mut pairs = vec![
+            (judge_files.join("testlib.h"), bundled.join("testlib.h")),
+            (
+                judge_files.join("aoj_checker.py"),
+                bundled.join("aoj_checker.py"),
+            ),
+        ];
+        let mut checkers: Vec<_> = std::fs::read_dir(bundled.join("checkers"))
+            .unwrap()
+            .map(|entry| entry.unwrap().file_name())
+            .collect();
+        checkers.sort();
+        let mut judge_checkers: Vec<_> = std::fs::read_dir(judge_files.join("checkers"))
+            .unwrap()
+            .map(|entry| entry.unwrap().file_name())
+            .filter(|name| Path::new(name).extension().is_some_and(|e| e == "cpp"))
+            .collect();
+        judge_checkers.sort();
+        assert_eq!(checkers, judge_checkers, "bundled checker sets differ");
+        for name in checkers {
+            pairs.push((
+                judge_files.join("checkers").join(&name),
+                bundled.join("checkers").join(&name),
+            ));
+        }
+
+        for (copy, source) in pairs {
+            assert!(
+                std::fs::read(&copy).unwrap() == std::fs::read(&source).unwrap(),
+                "{:?} differs from {:?}, copy it over",
+                copy,
+                source
+            );
+        }
+    }
+
+    #[test]
+    fn cache_key_changes_with_testlib_and_compiler() {
+        let base = cache_key(&cache_key_salt(b"12.2.0", b"testlib"), "src");
+        assert_ne!(
+            base,
+            cache_key(&cache_key_salt(b"12.2.0", b"testlib v2"), "src")
+        );
+        assert_ne!(
+            base,
+            cache_key(&cache_key_salt(b"13.1.0", b"testlib"), "src")
+        );
     }
 }
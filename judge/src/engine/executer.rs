@@ -86,6 +86,8 @@ pub struct ExecutionSpec {
     pub command: Vec<String>,
     pub limits: ExecutionLimits,
     pub stdin: Option<String>,
+    /// File to use as stdin, staged into the box without reading it
+    pub stdin_file: Option<std::path::PathBuf>,
     /// Directory to copy output files to after sandboxed execution
     pub copy_out_dir: Option<std::path::PathBuf>,
     /// Additional environment variables for the sandbox
@@ -101,6 +103,7 @@ impl ExecutionSpec {
             command: vec![],
             limits: ExecutionLimits::default(),
             stdin: None,
+            stdin_file: None,
             copy_out_dir: None,
             env_vars: vec![],
             share_net: false,
@@ -120,6 +123,11 @@ impl ExecutionSpec {
         self
     }
 
+    pub fn with_stdin_file(mut self, path: impl Into<std::path::PathBuf>) -> Self {
+        self.stdin_file = Some(path.into());
+        self
+    }
+
     pub fn with_copy_out_dir(mut self, dir: impl Into<std::path::PathBuf>) -> Self {
         self.copy_out_dir = Some(dir.into());
         self
@@ -166,6 +174,8 @@ pub async fn execute_sandboxed(spec: &ExecutionSpec) -> anyhow::Result<Execution
     let mut io = IoSpec::new();
     if let Some(ref temp_file) = stdin_path {
         io = io.with_stdin(temp_file.path());
+    } else if let Some(ref stdin_file) = spec.stdin_file {
+        io = io.with_stdin(stdin_file);
     }
     io.env_vars = spec.env_vars.clone();
     io.share_net = spec.share_net;
@@ -193,6 +203,14 @@ pub async fn execute_sandboxed(spec: &ExecutionSpec) -> anyhow::Result<Execution
             }
             let file_name = entry.file_name();
             let dest = copy_out_dir.join(&file_name);
+            // Files staged by link_or_copy may be hard links to `dest` itself,
+            // copying one onto itself would truncate it
+            if let Ok(dest_metadata) = fs::metadata(&dest).await {
+                use std::os::unix::fs::MetadataExt;
+                if dest_metadata.dev() == metadata.dev() && dest_metadata.ino() == metadata.ino() {
+                    continue;
+                }
+            }
             fs::copy(entry.path(), &dest).await?;
         }
     }
@@ -402,3 +420,231 @@ pub async fn execute_interactive(
         timed_out,
     })
 }
+
+/// Maximum number of bytes a streamed solution may write (mirrors the sandbox fsize limit)
+pub const STREAM_OUTPUT_LIMIT_BYTES: u64 = 262144 * 1024;
+
+/// Number of leading output bytes kept for the testcase output preview
+const STREAM_PREVIEW_BYTES: usize = 16384;
+
+/// Result of a streaming execution (user program piped into a checker)
+#[derive(Debug)]
+pub struct StreamingOutcome {
+    /// User program execution status
+    pub user_status: ExecutionStatus,
+    /// User program CPU time in milliseconds
+    pub user_time_ms: u32,
+    /// User program memory used in KB
+    pub user_memory_kb: u32,
+    /// Leading part of the user output (for the testcase preview)
+    pub output_preview: String,
+    /// Whether the user output exceeded `STREAM_OUTPUT_LIMIT_BYTES`
+    pub output_limit_exceeded: bool,
+    /// Checker execution status
+    pub checker_status: ExecutionStatus,
+    /// Checker stderr output (checker messages)
+    pub checker_stderr: String,
+    /// Whether the checker exited before the user program closed its output
+    pub checker_finished_early: bool,
+    /// Whether the overall execution timed out
+    pub timed_out: bool,
+}
+
+/// Convert isolate meta of a piped run to ExecutionStatus
+fn piped_status(meta: &sandbox::meta::IsolateMeta, memory_limit_kb: u32) -> ExecutionStatus {
+    let status = match meta.status {
+        IsolateStatus::Ok if meta.exit_code == 0 => ExecutionStatus::Exited(0),
+        IsolateStatus::Ok => ExecutionStatus::Exited(meta.exit_code),
+        IsolateStatus::TimeOut => ExecutionStatus::TimeLimitExceeded,
+        IsolateStatus::Signal(sig) => ExecutionStatus::Signaled(sig),
+        IsolateStatus::RuntimeError => ExecutionStatus::Exited(meta.exit_code),
+        IsolateStatus::InternalError => ExecutionStatus::SystemError,
+    };
+
+    if meta.cg_oom_killed || meta.memory_kb > memory_limit_kb {
+        ExecutionStatus::MemoryLimitExceeded
+    } else {
+        status
+    }
+}
+
+/// Execute a user program with its stdout piped straight into a checker.
+///
+/// Both programs run in their own isolate boxes at the same time:
+/// - `stdin_file` → User stdin
+/// - User stdout → Checker stdin
+///
+/// The checker is expected to read the output from stdin (testlib `registerTestlibStream`
+/// with `-` as the output file). If it exits before the user program has closed its
+/// output with a status `is_final` holds for (it rejected the output), the user program
+/// is killed right away. Otherwise the user program runs to its end, the rest of its
+/// output is read and dropped, so its own status is still known.
+pub async fn execute_streaming(
+    user_spec: &ExecutionSpec,
+    stdin_file: &std::path::Path,
+    checker_spec: &ExecutionSpec,
+    overall_timeout_secs: u64,
+    is_final: fn(&ExecutionStatus) -> bool,
+) -> anyhow::Result<StreamingOutcome> {
+    use std::sync::atomic::AtomicBool;
+    use std::sync::Arc;
+    use tokio::io::{AsyncReadExt, AsyncWriteExt};
+
+    if !is_cgroups_available().await {
+        anyhow::bail!("Cgroup support required for streaming execution");
+    }
+    let mut input = fs::File::open(stdin_file)
+        .await
+        .with_context(|| format!("Failed to open stdin file {:?}", stdin_file))?;
+
+    let user_box = IsolateBox::new(next_box_id(), true).await?;
+    user_box.copy_dir_in(&user_spec.work_dir).await?;
+    let checker_box = IsolateBox::new(next_box_id(), true).await?;
+    checker_box.copy_dir_in(&checker_spec.work_dir).await?;
+
+    let user_limits = Limits {
+        time_ms: user_spec.limits.time_ms,
+        memory_mb: user_spec.limits.memory_mb,
+        processes: 64,
+        open_files: 256,
+        fsize_kb: 262144,
+    };
+    let checker_limits = Limits {
+        time_ms: checker_spec.limits.time_ms,
+        memory_mb: checker_spec.limits.memory_mb,
+        processes: 64,
+        open_files: 256,
+        fsize_kb: 262144,
+    };
+
+    // Start the checker first so it is already waiting when the first output arrives
+    let (mut checker_child, checker_meta_file) = checker_box
+        .spawn_piped(
+            &checker_spec.command,
+            &checker_limits,
+            &checker_spec.env_vars,
+        )
+        .await?;
+    let (mut user_child, user_meta_file) = user_box
+        .spawn_piped(&user_spec.command, &user_limits, &user_spec.env_vars)
+        .await?;
+
+    let mut user_stdin = user_child.stdin.take().unwrap();
+    let mut user_stdout = user_child.stdout.take().unwrap();
+    let mut checker_stdin = checker_child.stdin.take().unwrap();
+    let mut checker_stdout = checker_child.stdout.take().unwrap();
+
+    // Feed the testcase input from its file; the user program may stop reading early
+    let feed_input = tokio::spawn(async move {
+        let _ = tokio::io::copy(&mut input, &mut user_stdin).await;
+    });
+
+    // Connect pipes: user stdout → checker stdin, keeping a preview and a size cap.
+    // The user output is always drained at once and queued for the checker: a checker
+    // that reads other files first must not stall the user program on a full pipe (its
+    // wall time would run out). The size cap also bounds the queue.
+    let (chunk_tx, mut chunk_rx) = tokio::sync::mpsc::unbounded_channel::<Vec<u8>>();
+    let pump_output = tokio::spawn(async move {
+        let mut buf = vec![0u8; 64 * 1024];
+        let mut preview = Vec::new();
+        let mut total: u64 = 0;
+        loop {
+            let n = match user_stdout.read(&mut buf).await {
+                Ok(0) | Err(_) => return (preview, false),
+                Ok(n) => n,
+            };
+            total += n as u64;
+            if total > STREAM_OUTPUT_LIMIT_BYTES {
+                return (preview, true);
+            }
+            if preview.len() < STREAM_PREVIEW_BYTES {
+                let take = n.min(STREAM_PREVIEW_BYTES - preview.len());
+                preview.extend_from_slice(&buf[..take]);
+            }
+            // Fails once the checker is gone: it has already decided, keep draining
+            let _ = chunk_tx.send(buf[..n].to_vec());
+        }
+    });
+    let output_closed = Arc::new(AtomicBool::new(false));
+    let output_closed_flag = output_closed.clone();
+    let feed_checker = tokio::spawn(async move {
+        while let Some(chunk) = chunk_rx.recv().await {
+            if checker_stdin.write_all(&chunk).await.is_err() {
+                return;
+            }
+        }
+        output_closed_flag.store(true, Ordering::Release);
+    });
+
+    // testlib checkers write nothing to stdout, but never let the pipe fill up
+    let drain_checker = tokio::spawn(async move {
+        let mut sink = Vec::new();
+        let _ = checker_stdout.read_to_end(&mut sink).await;
+    });
+
+    let checker_memory_kb = checker_spec.limits.memory_mb * 1024;
+    let timeout = std::time::Duration::from_secs(overall_timeout_secs);
+    let result = tokio::time::timeout(timeout, async {
+        let _ = checker_child.wait().await;
+        // The flag is set before checker stdin is closed, so a checker that exited
+        // because of the end of output always sees it here.
+        let finished_early = !output_closed.load(Ordering::Acquire);
+        let checker_results = checker_box.read_piped_results(&checker_meta_file).await;
+        if finished_early {
+            let rejected = match &checker_results {
+                Ok((meta, _)) => is_final(&piped_status(meta, checker_memory_kb)),
+                Err(_) => false,
+            };
+            if rejected {
+                let _ = user_child.kill().await;
+            }
+        }
+        let _ = user_child.wait().await;
+        let (preview, limit_exceeded) = pump_output.await.unwrap_or_default();
+        (finished_early, checker_results, preview, limit_exceeded)
+    })
+    .await;
+
+    let (timed_out, checker_finished_early, checker_results, preview, output_limit_exceeded) =
+        match result {
+            Ok((finished_early, checker_results, preview, limit_exceeded)) => (
+                false,
+                finished_early,
+                checker_results,
+                preview,
+                limit_exceeded,
+            ),
+            Err(_) => {
+                // Timeout — kill both processes
+                let _ = user_child.kill().await;
+                let _ = checker_child.kill().await;
+                let _ = user_child.wait().await;
+                let _ = checker_child.wait().await;
+                let checker_results = checker_box.read_piped_results(&checker_meta_file).await;
+                (true, false, checker_results, Vec::new(), false)
+            }
+        };
+    feed_input.abort();
+    feed_checker.abort();
+    drain_checker.abort();
+
+    let (user_meta, _user_stderr) = user_box.read_piped_results(&user_meta_file).await?;
+    let (checker_meta, checker_stderr) = checker_results?;
+    user_box.cleanup().await?;
+    checker_box.cleanup().await?;
+
+    Ok(StreamingOutcome {
+        user_status: piped_status(&user_meta, user_spec.limits.memory_mb * 1024),
+        user_time_ms: user_meta.time_ms,
+        user_memory_kb: user_meta.memory_kb,
+        output_preview: String::from_utf8_lossy(&preview)
+            .chars()
+            .take(4096)
+            .collect(),
+        output_limit_exceeded,
+        checker_status: piped_status(&checker_meta, checker_memory_kb),
+        checker_stderr,
+        checker_finished_early,
+        timed_out,
+    })
+}
@@ -51,10 +51,24 @@ pub async fn ensure_cgroups_available() -> Result<()> {
     }
 }
 
+/// Stage a file at `dest` without copying its contents when possible
+///
+/// A hard link shares the inode, so the box sees the same root-owned file with the
+/// same permissions a copy would have (read-only for the sandboxed user). Falls back
+/// to a copy when `source` is on another filesystem.
+pub async fn link_or_copy(source: &Path, dest: &Path) -> Result<()> {
+    if fs::hard_link(source, dest).await.is_err() {
+        fs::copy(source, dest)
+            .await
+            .with_context(|| format!("Failed to stage {:?} into {:?}", source, dest))?;
+    }
+    Ok(())
+}
+
 /// I/O specification for sandbox execution
 #[derive(Debug, Default, Clone)]
 pub struct IoSpec {
-    /// Path to stdin file (will be copied into box)
+    /// Path to stdin file (will be linked or copied into box)
     pub stdin_path: Option<std::path::PathBuf>,
     /// File name for stdout inside the box
     pub stdout_file: String,
@@ -175,7 +189,7 @@ impl IsolateBox {
         format!("{}/box", self.box_path)
     }
 
-    /// Copy a directory's contents into the box's working directory
+    /// Stage a directory's contents into the box's working directory (see [`link_or_copy`])
     pub async fn copy_dir_in(&self, source_dir: &Path) -> Result<()> {
         let mut entries = fs::read_dir(source_dir).await?;
         while let Some(entry) = entries.next_entry().await? {
@@ -189,7 +203,7 @@ impl IsolateBox {
                 self.work_dir(),
                 entry.file_name().to_string_lossy()
             );
-            fs::copy(entry.path(), &dest).await?;
+            link_or_copy(&entry.path(), Path::new(&dest)).await?;
         }
         Ok(())
     }
@@ -272,7 +286,7 @@ impl IsolateBox {
         // Handle stdin
         if let Some(stdin_path) = &io.stdin_path {
             let dest = format!("{}/stdin.txt", self.work_dir());
-            fs::copy(stdin_path, &dest).await?;
+            link_or_copy(stdin_path, Path::new(&dest)).await?;
             args.push("--stdin=stdin.txt".to_string());
         }
 
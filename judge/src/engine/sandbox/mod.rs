@@ -4,7 +4,7 @@
 //! It handles:
 //! - Isolate box initialization and cleanup
 //! - Cgroup detection and configuration
-//! - File copy in/out helpers
+//! - File staging (hard link or copy) in/out helpers
 //! - Raw command execution returning `SandboxOutcome`
 //!
 //! The sandbox module does NOT:
@@ -18,5 +18,7 @@ pub mod meta;
 
 // Re-exports for convenience
 pub use config::{get_config, init_config};
-pub use isolate_box::{ensure_cgroups_available, is_cgroups_available, IoSpec, IsolateBox, Limits};
+pub use isolate_box::{
+    ensure_cgroups_available, is_cgroups_available, link_or_copy, IoSpec, IsolateBox, Limits,
+};
 pub use meta::IsolateStatus;
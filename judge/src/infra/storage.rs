@@ -4,6 +4,7 @@ use anyhow::{Context, Result};
 use aws_config::BehaviorVersion;
 use aws_sdk_s3::config::{Credentials, Region};
 use aws_sdk_s3::Client;
+use std::path::Path;
 use tracing::info;
 
 /// S3/MinIO storage client
@@ -60,6 +61,49 @@ impl StorageClient {
         Ok(data.into_bytes().to_vec())
     }
 
+    /// Download a file from S3/MinIO straight into `path`, chunk by chunk, without
+    /// holding it in memory. Line endings are normalized like `download_string`
+    /// (`\r\n` -> `\n`); `on_chunk` sees the normalized bytes (e.g. to hash the content).
+    pub async fn download_to_file(
+        &self,
+        key: &str,
+        path: &Path,
+        mut on_chunk: impl FnMut(&[u8]),
+    ) -> Result<()> {
+        use tokio::io::AsyncWriteExt;
+
+        let mut response = self
+            .client
+            .get_object()
+            .bucket(&self.bucket)
+            .key(key)
+            .send()
+            .await
+            .with_context(|| format!("Failed to download {}", key))?;
+
+        let mut file = tokio::fs::File::create(path)
+            .await
+            .with_context(|| format!("Failed to create {:?}", path))?;
+        let mut pending_cr = false;
+        let mut normalized = Vec::new();
+        while let Some(chunk) = response
+            .body
+            .try_next()
+            .await
+            .with_context(|| format!("Failed to download {}", key))?
+        {
+            normalize_crlf_chunk(&chunk, &mut pending_cr, &mut normalized);
+            on_chunk(&normalized);
+            file.write_all(&normalized).await?;
+        }
+        if pending_cr {
+            on_chunk(b"\r");
+            file.write_all(b"\r").await?;
+        }
+        file.flush().await?;
+        Ok(())
+    }
+
     /// Download a file as string
     pub async fn download_string(&self, key: &str) -> Result<String> {
         let bytes = self.download(key).await?;
@@ -83,6 +127,22 @@ impl StorageClient {
         Ok(())
     }
 
+    /// Copy an object to another key inside the bucket, without downloading it
+    ///
+    /// Keys are used as-is in the copy source, so they must not need URL escaping
+    /// (the judge only copies its own `[A-Za-z0-9/._-]` keys).
+    pub async fn copy(&self, from_key: &str, to_key: &str) -> Result<()> {
+        self.client
+            .copy_object()
+            .bucket(&self.bucket)
+            .copy_source(format!("{}/{}", self.bucket, from_key))
+            .key(to_key)
+            .send()
+            .await
+            .with_context(|| format!("Failed to copy {} to {}", from_key, to_key))?;
+        Ok(())
+    }
+
     /// Check if a file exists
     #[allow(dead_code)]
     pub async fn exists(&self, key: &str) -> bool {
@@ -95,3 +155,64 @@ impl StorageClient {
             .is_ok()
     }
 }
+
+/// Replace `\r\n` with `\n` in one chunk of a stream, writing the result to `out`.
+///
+/// A `\r` ending the chunk is held back in `pending_cr`, since its `\n` may start the
+/// next chunk; the caller emits it if the stream ends there.
+fn normalize_crlf_chunk(chunk: &[u8], pending_cr: &mut bool, out: &mut Vec<u8>) {
+    out.clear();
+    let mut rest = chunk;
+    if *pending_cr && !rest.is_empty() {
+        *pending_cr = false;
+        if rest.first() != Some(&b'\n') {
+            out.push(b'\r');
+        }
+    }
+    while let Some(pos) = rest.iter().position(|&b| b == b'\r') {
+        out.extend_from_slice(&rest[..pos]);
+        match rest.get(pos + 1) {
+            Some(b'\n') => {}
+            Some(_) => out.push(b'\r'),
+            None => *pending_cr = true,
+        }
+        rest = &rest[pos + 1..];
+    }
+    out.extend_from_slice(rest);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn normalize(chunks: &[&[u8]]) -> Vec<u8> {
+        let mut pending_cr = false;
+        let mut out = Vec::new();
+        let mut result = Vec::new();
+        for chunk in chunks {
+            normalize_crlf_chunk(chunk, &mut pending_cr, &mut out);
+            result.extend_from_slice(&out);
+        }
+        if pending_cr {
+            result.push(b'\r');
+        }
+        result
+    }
+
+    #[test]
+    fn test_normalize_crlf_matches_download_string() {
+        let text = "1 2\r\n3\r4\r\r\n\r\n5\r";
+        let expected = text.replace("\r\n", "\n");
+        assert_eq!(normalize(&[text.as_bytes()]), expected.as_bytes());
+    }
+
+    #[test]
+    fn test_normalize_crlf_across_chunks() {
+        assert_eq!(normalize(&[b"a\r", b"\nb"]), b"a\nb");
+        assert_eq!(normalize(&[b"a\r", b"b"]), b"a\rb");
+        assert_eq!(normalize(&[b"a\r", b"\r", b"\n"]), b"a\r\n");
+        assert_eq!(normalize(&[b"a\r", b""]), b"a\r");
+        assert_eq!(normalize(&[b"a\r", b"", b"\n"]), b"a\n");
+        assert_eq!(normalize(&[b"a", b"\r"]), b"a\r");
+    }
+}
@@ -153,6 +153,7 @@ pub async fn process_anigma_job(
             memory_used: None,
             output: None,
             checker_message: None,
+            points: None,
         });
     }
 
@@ -407,6 +408,7 @@ async fn run_anigma_testcase(
         memory_used,
         output: Some(output.chars().take(4096).collect()),
         checker_message: None,
+        points: None,
     })
 }
 
@@ -9,15 +9,17 @@ use std::path::Path;
 use tracing::{info, warn};
 
 use crate::components::checker::{
-    is_interactive_checker, is_python_checker, CheckerManager, DEFAULT_CHECKER_TIMEOUT_SECS,
+    is_interactive_checker, is_python_checker, partial_credit, CheckerManager, CheckerMode,
+    CheckerServer, DEFAULT_CHECKER_TIMEOUT_SECS,
 };
+use crate::components::testlib_profile::TestlibProfile;
 use crate::core::languages::{self, LanguageConfig};
 use crate::core::verdict::Verdict;
 use crate::engine::compiler::{compile_in_sandbox, compile_on_host};
 use crate::engine::executer::{execute_sandboxed, ExecutionLimits, ExecutionSpec, ExecutionStatus};
 use crate::engine::sandbox::get_config;
 use crate::infra::storage::StorageClient;
-use crate::jobs::subtask::{aggregate_subtasks, TestcaseOutcome};
+use crate::jobs::subtask::{aggregate_subtasks, group_score, testcase_credit, TestcaseOutcome};
 
 /// Problem type enum for judging strategy
 #[derive(Debug, Serialize, Deserialize, Clone, Copy, PartialEq, Default)]
@@ -100,6 +102,9 @@ pub struct TestcaseResult {
     /// Checker stderr message (for admin visibility)
     #[serde(skip_serializing_if = "Option::is_none")]
     pub checker_message: Option<String>,
+    /// Fraction of the testcase score awarded by a partial checker verdict (quitp / _pc)
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub points: Option<f64>,
 }
 
 /// Process a judge job
@@ -201,7 +206,17 @@ pub async fn process_judge_job(
                         .get_cpp_checker(storage, path, job.problem_id)
                         .await
                     {
-                        Ok(binary_path) => Some(CheckerInfo::Cpp(binary_path)),
+                        Ok(checker) if checker.mode == CheckerMode::Server => {
+                            Some(CheckerInfo::CppServer(CheckerServer::new(
+                                checker.path,
+                                job.testcases.len(),
+                                DEFAULT_CHECKER_TIMEOUT_SECS,
+                            )))
+                        }
+                        Ok(checker) if checker.mode == CheckerMode::Stream => {
+                            Some(CheckerInfo::CppStreaming(checker.path))
+                        }
+                        Ok(checker) => Some(CheckerInfo::Cpp(checker.path)),
                         Err(e) => {
                             warn!(
                                 "Failed to get checker for problem {}: {:#}",
@@ -293,6 +308,7 @@ pub async fn process_judge_job(
             "memory_limit_exceeded" => Verdict::MemoryLimitExceeded,
             "runtime_error" => Verdict::RuntimeError,
             "skipped" => Verdict::Skipped,
+            "partial" => Verdict::Partial,
             _ => Verdict::SystemError,
         }
     }
@@ -302,6 +318,8 @@ pub async fn process_judge_job(
 
     if job.has_subtasks {
         // IOI-style: group by subtask_group, fail-fast within group, continue across groups.
+        // A group scores by its lowest credit, so it stops at the first testcase earning
+        // nothing; partial credits keep it running (a later testcase may earn less).
         use std::collections::BTreeMap;
         let mut grouped: BTreeMap<i32, Vec<&TestcaseInfo>> = BTreeMap::new();
         for tc in &job.testcases {
@@ -320,6 +338,7 @@ pub async fn process_judge_job(
                         memory_used: None,
                         output: None,
                         checker_message: None,
+                        points: None,
                     });
                 } else {
                     let r = run_single_testcase(
@@ -338,7 +357,7 @@ pub async fn process_judge_job(
                     if let Some(m) = r.memory_used {
                         max_memory = max_memory.max(m);
                     }
-                    if r.verdict != Verdict::Accepted.to_string() {
+                    if testcase_credit(parse_verdict(&r.verdict), r.points) == 0.0 {
                         group_failed = true;
                     }
                     testcase_results.push(r);
@@ -367,18 +386,25 @@ pub async fn process_judge_job(
             .testcases
             .iter()
             .zip(testcase_results.iter())
-            .map(|(tc, r)| TestcaseOutcome {
-                subtask_group: tc.subtask_group,
-                score: tc.score,
-                verdict: parse_verdict(r.verdict.as_str()),
+            .map(|(tc, r)| {
+                let verdict = parse_verdict(r.verdict.as_str());
+                TestcaseOutcome {
+                    subtask_group: tc.subtask_group,
+                    score: tc.score,
+                    verdict,
+                    credit: testcase_credit(verdict, r.points),
+                }
             })
             .collect();
         let agg = aggregate_subtasks(&outcomes, job.max_score);
         overall_verdict = agg.overall_verdict;
         final_score = agg.final_score;
     } else {
-        // Legacy non-subtask path: fail-fast on first non-accepted; score is all-or-nothing.
-        let mut legacy_verdict = Verdict::Accepted;
+        // Legacy non-subtask path: the whole problem is one group worth max_score.
+        // Fail-fast on the first testcase earning nothing; partial credits scale the
+        // score by the lowest one.
+        let mut first_failure: Option<Verdict> = None;
+        let mut min_credit = 1.0f64;
         for (idx, tc) in job.testcases.iter().enumerate() {
             let tc_result = run_single_testcase(
                 job,
@@ -399,14 +425,18 @@ pub async fn process_judge_job(
             }
 
             let verdict = parse_verdict(tc_result.verdict.as_str());
+            let credit = testcase_credit(verdict, tc_result.points);
             testcase_results.push(tc_result);
 
             let _ = redis
                 .publish_progress(job.submission_id, idx + 1, total_testcases)
                 .await;
 
-            if verdict != Verdict::Accepted && legacy_verdict == Verdict::Accepted {
-                legacy_verdict = verdict;
+            min_credit = min_credit.min(credit);
+            if credit == 0.0 {
+                if verdict != Verdict::Partial {
+                    first_failure = Some(verdict);
+                }
                 break;
             }
         }
@@ -419,17 +449,26 @@ pub async fn process_judge_job(
                 memory_used: None,
                 output: None,
                 checker_message: None,
+                points: None,
             });
         }
 
-        overall_verdict = legacy_verdict;
-        final_score = if legacy_verdict == Verdict::Accepted {
-            job.max_score
+        final_score = group_score(job.max_score, min_credit);
+        // Same rule as aggregate_subtasks: a score rounded down to 0 is not Partial
+        overall_verdict = if min_credit >= 1.0 {
+            Verdict::Accepted
+        } else if final_score > 0 {
+            Verdict::Partial
         } else {
-            0
+            first_failure.unwrap_or(Verdict::WrongAnswer)
         };
     }
 
+    // Stop the checker server if one was started
+    if let Some(CheckerInfo::CppServer(server)) = &checker_info {
+        server.shutdown().await;
+    }
+
     // Stop storage proxy if it was started
     if let Some((proxy, _)) = storage_proxy {
         proxy.stop().await;
@@ -496,6 +535,10 @@ pub async fn process_judge_job(
 enum CheckerInfo {
     /// Compiled C++ binary path
     Cpp(std::path::PathBuf),
+    /// Compiled C++ binary path of a checker reading the output from stdin
+    CppStreaming(std::path::PathBuf),
+    /// Persistent C++ checker process shared by all testcases
+    CppServer(CheckerServer),
     /// Python output checker source code
     Python(String),
     /// Python interactive checker source code
@@ -525,8 +568,17 @@ async fn run_single_testcase(
         .await;
     }
 
-    let input_content = storage
-        .download_string(&tc.input_path)
+    // Streaming mode: pipe user output into the checker while the program runs
+    if let Some(CheckerInfo::CppStreaming(checker_path)) = checker_info {
+        return run_streaming_testcase(job, tc, work_dir, lang_config, storage, checker_path).await;
+    }
+
+    // The input is written once: the program's stdin and the checker's input are
+    // staged into the boxes from this file
+    let testcase_dir = tempfile::tempdir()?;
+    let input_path = testcase_dir.path().join("input.txt");
+    storage
+        .download_to_file(&tc.input_path, &input_path, |_| {})
         .await
         .with_context(|| format!("Failed to download testcase input: {}", tc.input_path))?;
 
@@ -553,7 +605,7 @@ async fn run_single_testcase(
             time_ms: adjusted_time_limit,
             memory_mb: adjusted_memory_limit,
         })
-        .with_stdin(&input_content);
+        .with_stdin_file(&input_path);
 
     let run_result = execute_sandboxed(&spec).await?;
 
@@ -569,14 +621,31 @@ async fn run_single_testcase(
         ExecutionStatus::Exited(0) => {
             // Program ran successfully, check output
             match checker_info {
+                Some(CheckerInfo::CppServer(server)) => {
+                    // Checker server: files go straight into its box, no temp dir
+                    match server
+                        .check(
+                            &input_path,
+                            &run_result.stdout_bytes,
+                            expected_output.as_bytes(),
+                        )
+                        .await
+                    {
+                        Ok(r) => {
+                            log_checker_profile(tc.id, r.profile.as_ref());
+                            (r.verdict, r.checker_message)
+                        }
+                        Err(e) => {
+                            warn!("Checker server failed for testcase {}: {}", tc.id, e);
+                            (Verdict::SystemError, Some(format!("{:#}", e)))
+                        }
+                    }
+                }
                 Some(info) => {
                     // Special judge: run checker
-                    let checker_temp_dir = tempfile::tempdir()?;
-                    let input_path = checker_temp_dir.path().join("input.txt");
-                    let output_path = checker_temp_dir.path().join("output.txt");
-                    let answer_path = checker_temp_dir.path().join("answer.txt");
+                    let output_path = testcase_dir.path().join("output.txt");
+                    let answer_path = testcase_dir.path().join("answer.txt");
 
-                    tokio::fs::write(&input_path, &input_content).await?;
                     tokio::fs::write(&output_path, &run_result.stdout).await?;
                     tokio::fs::write(&answer_path, &expected_output).await?;
 
@@ -591,7 +660,10 @@ async fn run_single_testcase(
                             )
                             .await
                             {
-                                Ok(r) => (r.verdict, r.checker_message),
+                                Ok(r) => {
+                                    log_checker_profile(tc.id, r.profile.as_ref());
+                                    (r.verdict, r.checker_message)
+                                }
                                 Err(e) => {
                                     warn!("Checker failed for testcase {}: {}", tc.id, e);
                                     (Verdict::SystemError, Some(format!("{:#}", e)))
@@ -616,9 +688,13 @@ async fn run_single_testcase(
                                 }
                             }
                         }
-                        CheckerInfo::Interactive(_) => {
-                            // Should not reach here — handled by early return above
-                            unreachable!("Interactive checker handled separately")
+                        CheckerInfo::Interactive(_)
+                        | CheckerInfo::CppStreaming(_)
+                        | CheckerInfo::CppServer(_) => {
+                            // Should not reach here — handled separately above
+                            unreachable!(
+                                "Interactive, streaming and server checkers handled separately"
+                            )
                         }
                     }
                 }
@@ -639,7 +715,8 @@ async fn run_single_testcase(
         ExecutionStatus::SystemError => (Verdict::SystemError, None),
     };
 
-    let (execution_time, memory_used) = if verdict == Verdict::Accepted {
+    let (verdict, points) = checker_points(verdict, checker_message.as_deref());
+    let (execution_time, memory_used) = if counts_usage(verdict) {
         (Some(run_result.time_ms), Some(run_result.memory_kb))
     } else {
         (None, None)
@@ -652,9 +729,47 @@ async fn run_single_testcase(
         memory_used,
         output: output_preview,
         checker_message,
+        points,
     })
 }
 
+/// Partial credit kept on the testcase result, for `Partial` checker verdicts only.
+///
+/// The credit is a fraction of the testcase score (see `partial_credit`). A
+/// partial verdict without readable points, or with points outside of [0, 1]
+/// (e.g. Polygon-style absolute points, `quitp(40)`), stays `Partial` with no
+/// credit and a warning: the checker did run and judged the output.
+fn checker_points(verdict: Verdict, checker_message: Option<&str>) -> (Verdict, Option<f64>) {
+    if verdict != Verdict::Partial {
+        return (verdict, None);
+    }
+    match partial_credit(checker_message) {
+        Some(credit) => (Verdict::Partial, Some(credit)),
+        None => {
+            warn!(
+                "Partial checker verdict without points in [0, 1], giving no credit: {:?}",
+                checker_message
+            );
+            (Verdict::Partial, Some(0.0))
+        }
+    }
+}
+
+/// Log the testlib profile record of a checker run, if it sent one
+fn log_checker_profile(testcase_id: i64, profile: Option<&TestlibProfile>) {
+    if let Some(profile) = profile {
+        info!(
+            "Checker profile for testcase {}: {:?}",
+            testcase_id, profile
+        );
+    }
+}
+
+/// Whether the program ran to completion, so its time and memory are reported
+fn counts_usage(verdict: Verdict) -> bool {
+    matches!(verdict, Verdict::Accepted | Verdict::Partial)
+}
+
 /// Compare program output with expected output
 pub fn compare_output(actual: &str, expected: &str) -> bool {
     // Normalize outputs: trim trailing whitespace from each line and trailing newlines
@@ -727,7 +842,8 @@ async fn run_interactive_testcase(
     .await
     {
         Ok(r) => {
-            let (execution_time, memory_used) = if r.verdict == Verdict::Accepted {
+            let (verdict, points) = checker_points(r.verdict, r.checker_message.as_deref());
+            let (execution_time, memory_used) = if counts_usage(verdict) {
                 (Some(r.user_time_ms), Some(r.user_memory_kb))
             } else {
                 (None, None)
@@ -735,11 +851,12 @@ async fn run_interactive_testcase(
 
             Ok(TestcaseResult {
                 testcase_id: tc.id,
-                verdict: r.verdict.to_string(),
+                verdict: verdict.to_string(),
                 execution_time,
                 memory_used,
                 output: None,
                 checker_message: r.checker_message,
+                points,
             })
         }
         Err(e) => {
@@ -751,6 +868,92 @@ async fn run_interactive_testcase(
                 memory_used: None,
                 output: None,
                 checker_message: Some(format!("{:#}", e)),
+                points: None,
+            })
+        }
+    }
+}
+
+/// Run a single testcase with a streaming checker.
+///
+/// The user output goes straight into the checker; no output file is written.
+/// The checker determines the verdict unless the user program fails first.
+async fn run_streaming_testcase(
+    job: &JudgeJob,
+    tc: &TestcaseInfo,
+    work_dir: &Path,
+    lang_config: &LanguageConfig,
+    storage: &StorageClient,
+    checker_path: &Path,
+) -> Result<TestcaseResult> {
+    // Written once, then linked into the boxes; the program's stdin is fed from the file
+    let testcase_dir = tempfile::tempdir()?;
+    let input_path = testcase_dir.path().join("input.txt");
+    let answer_path = testcase_dir.path().join("answer.txt");
+
+    storage
+        .download_to_file(&tc.input_path, &input_path, |_| {})
+        .await
+        .with_context(|| format!("Failed to download testcase input: {}", tc.input_path))?;
+    storage
+        .download_to_file(&tc.output_path, &answer_path, |_| {})
+        .await
+        .with_context(|| format!("Failed to download testcase output: {}", tc.output_path))?;
+
+    let adjusted_time_limit = if job.ignore_time_limit_bonus {
+        job.time_limit
+    } else {
+        lang_config.calculate_time_limit(job.time_limit)
+    };
+    let adjusted_memory_limit = if job.ignore_memory_limit_bonus {
+        job.memory_limit
+    } else {
+        lang_config.calculate_memory_limit(job.memory_limit)
+    };
+
+    match crate::components::checker::run_streaming_checker(
+        checker_path,
+        &input_path,
+        &answer_path,
+        work_dir,
+        &lang_config.run_command,
+        &ExecutionLimits {
+            time_ms: adjusted_time_limit,
+            memory_mb: adjusted_memory_limit,
+        },
+        DEFAULT_CHECKER_TIMEOUT_SECS,
+    )
+    .await
+    {
+        Ok(r) => {
+            log_checker_profile(tc.id, r.profile.as_ref());
+            let (verdict, points) = checker_points(r.verdict, r.checker_message.as_deref());
+            let (execution_time, memory_used) = if counts_usage(verdict) {
+                (Some(r.user_time_ms), Some(r.user_memory_kb))
+            } else {
+                (None, None)
+            };
+
+            Ok(TestcaseResult {
+                testcase_id: tc.id,
+                verdict: verdict.to_string(),
+                execution_time,
+                memory_used,
+                output: r.output_preview,
+                checker_message: r.checker_message,
+                points,
+            })
+        }
+        Err(e) => {
+            warn!("Streaming checker failed for testcase {}: {}", tc.id, e);
+            Ok(TestcaseResult {
+                testcase_id: tc.id,
+                verdict: Verdict::SystemError.to_string(),
+                execution_time: None,
+                memory_used: None,
+                output: None,
+                checker_message: Some(format!("{:#}", e)),
+                points: None,
             })
         }
     }
@@ -780,6 +983,28 @@ mod tests {
         assert!(!compare_output("hello\nworld\n", "hello\nearth\n"));
     }
 
+    #[test]
+    fn test_checker_points() {
+        assert_eq!(
+            checker_points(Verdict::Partial, Some("points 0.25")),
+            (Verdict::Partial, Some(0.25))
+        );
+        assert_eq!(
+            checker_points(Verdict::WrongAnswer, Some("points 0.25")),
+            (Verdict::WrongAnswer, None)
+        );
+    }
+
+    #[test]
+    fn test_checker_points_out_of_range_gives_no_credit() {
+        for message in [Some("points 40"), Some("points -1"), Some("ok"), None] {
+            assert_eq!(
+                checker_points(Verdict::Partial, message),
+                (Verdict::Partial, Some(0.0))
+            );
+        }
+    }
+
     #[test]
     fn test_problem_type_default() {
         let pt: ProblemType = Default::default();
@@ -2,6 +2,7 @@ pub mod anigma;
 pub mod judger;
 pub mod playground;
 pub mod subtask;
+pub mod validation_cache;
 pub mod validator;
 pub mod workshop;
 
@@ -11,6 +11,28 @@ pub struct TestcaseOutcome {
     pub subtask_group: i32,
     pub score: i64,
     pub verdict: Verdict,
+    /// Fraction of the score earned, see [`testcase_credit`]
+    pub credit: f64,
+}
+
+/// Fraction of its score a testcase earns: 1 when Accepted, the checker's
+/// partial credit when Partial, 0 otherwise.
+pub fn testcase_credit(verdict: Verdict, partial_credit: Option<f64>) -> f64 {
+    match verdict {
+        Verdict::Accepted => 1.0,
+        Verdict::Partial => partial_credit.unwrap_or(0.0).clamp(0.0, 1.0),
+        _ => 0.0,
+    }
+}
+
+/// Score of a group worth `total` whose lowest testcase credit is `min_credit`.
+/// Rounded down, so a partially solved group never reaches the full score.
+pub fn group_score(total: i64, min_credit: f64) -> i64 {
+    if min_credit >= 1.0 {
+        total
+    } else {
+        ((total as f64) * min_credit.max(0.0)).floor() as i64
+    }
 }
 
 #[derive(Debug, Clone)]
@@ -22,14 +44,16 @@ pub struct SubtaskAggregate {
 /// Aggregate per-testcase outcomes into a final subtask-aware score + verdict.
 ///
 /// Rules (IOI-style):
-/// - Group by subtask_group. For each group, if every TC is Accepted, award
-///   Σ tc.score; otherwise 0.
+/// - Group by subtask_group. For each group, award Σ tc.score scaled by the
+///   lowest credit in the group: all Accepted gives the full score, a failed
+///   TC gives 0, checker partial credits (quitp / _pc) give a part of it.
 /// - final_score = Σ group scores.
 /// - Overall verdict:
 ///   - final_score == max_score → Accepted
 ///   - 0 < final_score < max_score → Partial
-///   - final_score == 0 → first non-Accepted verdict encountered when
-///     iterating groups in ascending subtask_group order.
+///   - final_score == 0 → first verdict that is neither Accepted nor Partial
+///     when iterating groups in ascending subtask_group order, WrongAnswer if
+///     there is none (partial credits all rounded down to 0).
 pub fn aggregate_subtasks(outcomes: &[TestcaseOutcome], max_score: i64) -> SubtaskAggregate {
     if outcomes.is_empty() {
         return SubtaskAggregate {
@@ -48,13 +72,13 @@ pub fn aggregate_subtasks(outcomes: &[TestcaseOutcome], max_score: i64) -> Subta
     let mut first_failure: Option<Verdict> = None;
 
     for (_g, items) in groups.iter() {
-        let all_ac = items.iter().all(|i| i.verdict == Verdict::Accepted);
-        if all_ac {
-            final_score += items.iter().map(|i| i.score).sum::<i64>();
-        } else if first_failure.is_none() {
+        let total = items.iter().map(|i| i.score).sum::<i64>();
+        let min_credit = items.iter().map(|i| i.credit).fold(1.0f64, f64::min);
+        final_score += group_score(total, min_credit);
+        if first_failure.is_none() {
             first_failure = items
                 .iter()
-                .find(|i| i.verdict != Verdict::Accepted)
+                .find(|i| !matches!(i.verdict, Verdict::Accepted | Verdict::Partial))
                 .map(|i| i.verdict);
         }
     }
@@ -82,6 +106,16 @@ mod tests {
             subtask_group: g,
             score: s,
             verdict: v,
+            credit: testcase_credit(v, None),
+        }
+    }
+
+    fn partial(g: i32, s: i64, credit: f64) -> TestcaseOutcome {
+        TestcaseOutcome {
+            subtask_group: g,
+            score: s,
+            verdict: Verdict::Partial,
+            credit,
         }
     }
 
@@ -149,11 +183,13 @@ mod tests {
                 subtask_group: 1,
                 score: 50,
                 verdict: Verdict::Skipped,
+                credit: 0.0,
             },
             TestcaseOutcome {
                 subtask_group: 2,
                 score: 50,
                 verdict: Verdict::Skipped,
+                credit: 0.0,
             },
         ];
         let r = aggregate_subtasks(&outs, 100);
@@ -169,15 +205,60 @@ mod tests {
                 subtask_group: 2,
                 score: 70,
                 verdict: Verdict::WrongAnswer,
+                credit: 0.0,
             },
             TestcaseOutcome {
                 subtask_group: 1,
                 score: 30,
                 verdict: Verdict::TimeLimitExceeded,
+                credit: 0.0,
             },
         ];
         let r = aggregate_subtasks(&outs, 100);
         assert_eq!(r.final_score, 0);
         assert_eq!(r.overall_verdict, Verdict::TimeLimitExceeded);
     }
+
+    #[test]
+    fn partial_credit_scales_group_by_lowest_credit() {
+        let outs = vec![
+            tc(1, 20, Verdict::Accepted),
+            partial(1, 20, 0.5),
+            partial(1, 20, 0.75),
+            tc(2, 40, Verdict::Accepted),
+        ];
+        let r = aggregate_subtasks(&outs, 100);
+        assert_eq!(r.final_score, 30 + 40);
+        assert_eq!(r.overall_verdict, Verdict::Partial);
+    }
+
+    #[test]
+    fn partial_credit_rounds_down_and_failure_still_zeroes_group() {
+        let outs = vec![
+            partial(1, 1, 0.99),
+            partial(2, 50, 0.5),
+            tc(2, 49, Verdict::TimeLimitExceeded),
+        ];
+        let r = aggregate_subtasks(&outs, 100);
+        assert_eq!(r.final_score, 0);
+        assert_eq!(r.overall_verdict, Verdict::TimeLimitExceeded);
+    }
+
+    #[test]
+    fn partial_credit_rounded_down_to_zero_gives_wrong_answer() {
+        let outs = vec![partial(1, 1, 0.99), partial(2, 1, 0.5)];
+        let r = aggregate_subtasks(&outs, 2);
+        assert_eq!(r.final_score, 0);
+        assert_eq!(r.overall_verdict, Verdict::WrongAnswer);
+    }
+
+    #[test]
+    fn testcase_credit_by_verdict() {
+        assert_eq!(testcase_credit(Verdict::Accepted, None), 1.0);
+        assert_eq!(testcase_credit(Verdict::Partial, Some(0.4)), 0.4);
+        assert_eq!(testcase_credit(Verdict::Partial, None), 0.0);
+        assert_eq!(testcase_credit(Verdict::WrongAnswer, Some(0.4)), 0.0);
+        assert_eq!(group_score(30, 1.0), 30);
+        assert_eq!(group_score(3, 0.5), 1);
+    }
 }
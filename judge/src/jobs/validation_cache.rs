@@ -0,0 +1,126 @@
+//! Validation result cache — keyed by sha256 of the validator binary and of the input.
+//!
+//! Used to skip revalidating testcases when neither the validator nor the
+//! input changed, so a re-import or a single edited test only runs the
+//! validator on the deltas. Only accepted inputs are stored, each with the
+//! testlib test overview (bounds hits, features) of that input, so merged
+//! overviews stay complete. Cache lives in /tmp (process-local,
+//! container-restart wipes it — first job after restart re-warms the cache).
+//!
+//! Cache layout:
+//!   /tmp/aoj_validation_cache/{validator sha256}/{input sha256}.json
+
+use sha2::{Digest, Sha256};
+use std::path::PathBuf;
+use tracing::warn;
+
+use super::validator::InputValidation;
+
+const CACHE_ROOT: &str = "/tmp/aoj_validation_cache";
+
+/// Hex sha256 of a validator binary or an input file.
+pub fn hash_bytes(bytes: &[u8]) -> String {
+    format!("{:x}", Sha256::digest(bytes))
+}
+
+/// [`hash_bytes`] computed piece by piece, for inputs hashed while downloaded.
+#[derive(Default)]
+pub struct InputHasher(Sha256);
+
+impl InputHasher {
+    pub fn update(&mut self, bytes: &[u8]) {
+        self.0.update(bytes);
+    }
+
+    pub fn finish(self) -> String {
+        format!("{:x}", self.0.finalize())
+    }
+}
+
+/// Compute the cache path for a (validator, input) pair.
+pub fn entry_path(validator_hash: &str, input_hash: &str) -> PathBuf {
+    PathBuf::from(CACHE_ROOT)
+        .join(validator_hash)
+        .join(format!("{}.json", input_hash))
+}
+
+/// Return the stored result for this (validator, input) pair, if any.
+/// Unreadable or malformed entries count as misses.
+pub async fn load(validator_hash: &str, input_hash: &str) -> Option<InputValidation> {
+    let bytes = tokio::fs::read(entry_path(validator_hash, input_hash))
+        .await
+        .ok()?;
+    serde_json::from_slice(&bytes).ok()
+}
+
+/// Best-effort store a result. Logs and swallows errors (caching is an
+/// optimization, not a correctness requirement).
+pub async fn store(validator_hash: &str, input_hash: &str, result: &InputValidation) {
+    let path = entry_path(validator_hash, input_hash);
+    let Some(parent) = path.parent() else {
+        warn!("validation_cache: invalid cache path {:?}", path);
+        return;
+    };
+    if let Err(e) = tokio::fs::create_dir_all(parent).await {
+        warn!("validation_cache: create_dir_all {:?}: {:#}", parent, e);
+        return;
+    }
+    let bytes = match serde_json::to_vec(result) {
+        Ok(bytes) => bytes,
+        Err(e) => {
+            warn!("validation_cache: serialize {:?}: {:#}", path, e);
+            return;
+        }
+    };
+    // Concurrent jobs may store the same entry; write a unique temp file and
+    // rename it, which is atomic on the same filesystem.
+    let tmp_path = parent.join(format!(
+        "{}.tmp.{}.{}",
+        input_hash,
+        std::process::id(),
+        std::time::SystemTime::now()
+            .duration_since(std::time::UNIX_EPOCH)
+            .map(|d| d.as_nanos())
+            .unwrap_or(0)
+    ));
+    if let Err(e) = tokio::fs::write(&tmp_path, &bytes).await {
+        warn!("validation_cache: write {:?}: {:#}", tmp_path, e);
+        return;
+    }
+    if let Err(e) = tokio::fs::rename(&tmp_path, &path).await {
+        warn!(
+            "validation_cache: rename {:?} -> {:?}: {:#}",
+            tmp_path, path, e
+        );
+        let _ = tokio::fs::remove_file(&tmp_path).await;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn entry_path_includes_both_hashes() {
+        let p = entry_path("validator", "input");
+        assert!(p.ends_with("validator/input.json"));
+        assert!(p.starts_with(CACHE_ROOT));
+    }
+
+    #[test]
+    fn hash_bytes_is_hex_sha256() {
+        assert_eq!(
+            hash_bytes(b"abc"),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+        );
+    }
+
+    #[test]
+    fn input_hasher_matches_hash_bytes() {
+        let mut hasher = InputHasher::default();
+        hasher.update(b"1 2\r\n");
+        hasher.update(b"");
+        hasher.update(b"3\n");
+        assert_eq!(hasher.finish(), hash_bytes(b"1 2\r\n3\n"));
+    }
+}
@@ -5,12 +5,15 @@
 
 use anyhow::{Context, Result};
 use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, BTreeSet};
 use std::path::Path;
-use tokio::fs;
 use tracing::{debug, info, warn};
 
+use super::validation_cache;
+use crate::components::testlib_profile;
 use crate::engine::compiler::ValidatorCompiler;
-use crate::engine::executer::{ExecutionLimits, ExecutionSpec};
+use crate::engine::executer::{ExecutionLimits, ExecutionSpec, ExecutionStatus};
+use crate::engine::sandbox::link_or_copy;
 use crate::infra::storage::StorageClient;
 
 /// Validation job received from Redis queue
@@ -48,6 +51,9 @@ pub struct ValidateResult {
     pub success: bool,
     pub testcase_results: Vec<TestcaseValidationResult>,
     pub error_message: Option<String>,
+    /// testlib test overview (bounds hits, features) merged over all valid inputs
+    #[serde(default)]
+    pub overview: Option<String>,
 }
 
 impl ValidateResult {
@@ -57,6 +63,7 @@ impl ValidateResult {
             success: false,
             testcase_results: vec![],
             error_message: Some(error_message),
+            overview: None,
         }
     }
 }
@@ -64,16 +71,36 @@ impl ValidateResult {
 /// Validator exit codes (testlib.h based)
 mod validator_exit_codes {
     pub const OK: i32 = 0; // Valid input
-    #[allow(dead_code)]
     pub const FAIL: i32 = 3; // Invalid input (validation failed)
 }
 
+/// Outcome of validating one input, as stored in the validation cache
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct InputValidation {
+    pub valid: bool,
+    pub exit_code: i32,
+    pub message: Option<String>,
+    /// testlib test overview of this input, if the validator wrote one
+    #[serde(default)]
+    pub overview: Option<String>,
+}
+
+impl InputValidation {
+    /// Whether the same validator would give this result again. Only accepted
+    /// inputs are: `_fail` is also how testlib reports its own errors (an input
+    /// file it can't open, a bad argument), and crashes and time limits depend
+    /// on the run.
+    fn is_cacheable(&self) -> bool {
+        self.exit_code == validator_exit_codes::OK
+    }
+}
+
 /// Run a testlib.h-based validator on an input file
 pub async fn run_validator(
     validator_path: &Path,
     input_path: &Path,
     timeout_secs: u64,
-) -> Result<(bool, Option<String>)> {
+) -> Result<InputValidation> {
     info!(
         "Running validator: {:?} with input={:?}",
         validator_path, input_path
@@ -83,24 +110,27 @@ pub async fn run_validator(
     let temp_dir = tempfile::tempdir()?;
     let work_dir = temp_dir.path();
 
-    // Copy validator binary to the temp directory
+    // Stage validator binary in the temp directory
     let validator_bin = "validator";
-    tokio::fs::copy(validator_path, work_dir.join(validator_bin)).await?;
-
-    // Read input file content to pass as stdin (testlib validators read from stdin)
-    let input_content = fs::read_to_string(input_path)
-        .await
-        .context("Failed to read input file for validator")?;
+    link_or_copy(validator_path, &work_dir.join(validator_bin)).await?;
 
-    // Build execution spec for sandboxed validator
+    // Build execution spec for sandboxed validator, asking for the test overview
+    // as the batch mode does, so the result is as complete as a batch entry
+    let overview_name = "overview.log";
     let spec = ExecutionSpec::new(work_dir)
-        .with_command([format!("./{}", validator_bin)])
+        .with_command([
+            format!("./{}", validator_bin),
+            "--testOverviewLogFileName".to_string(),
+            overview_name.to_string(),
+        ])
         .with_limits(ExecutionLimits {
             // Use at least 10s as suggested by the user
             time_ms: (timeout_secs * 1000).max(10_000) as u32,
             memory_mb: 1024,
         })
-        .with_stdin(&input_content);
+        // testlib validators read from stdin, which is the input file linked into the box
+        .with_stdin_file(input_path)
+        .with_env_vars(testlib_profile::env_vars());
 
     let result = crate::engine::executer::execute_sandboxed(&spec)
         .await
@@ -112,16 +142,266 @@ pub async fn run_validator(
         result.stderr.chars().take(200).collect::<String>()
     );
 
-    let valid = result.exit_code() == validator_exit_codes::OK;
+    let exit_code = result.exit_code();
 
     // Validator message is typically in stderr
-    let message = if result.stderr.is_empty() {
+    let (stderr, profile) = testlib_profile::split_testlib_profile(&result.stderr);
+    if let Some(profile) = profile {
+        info!("Validator profile: {:?}", profile);
+    }
+    let message = if stderr.is_empty() {
         None
     } else {
-        Some(result.stderr.trim().to_string())
+        Some(stderr.trim().to_string())
     };
 
-    Ok((valid, message))
+    // Validators registered without argc/argv write no overview
+    let overview = tokio::fs::read(work_dir.join(overview_name))
+        .await
+        .ok()
+        .map(|bytes| String::from_utf8_lossy(&bytes).into_owned())
+        .filter(|o| !o.is_empty());
+
+    Ok(InputValidation {
+        valid: exit_code == validator_exit_codes::OK,
+        exit_code,
+        message,
+        overview,
+    })
+}
+
+/// One entry of the testlib validator `--batch` report
+#[derive(Debug, Deserialize)]
+struct BatchValidationEntry {
+    file: String,
+    #[serde(rename = "exitCode")]
+    exit_code: i32,
+    message: String,
+    /// Present when the validator was asked for per-file test overviews
+    #[serde(default)]
+    overview: Option<String>,
+    /// The copy validating this file was killed at the per-file time limit
+    #[serde(rename = "timeLimitExceeded", default)]
+    time_limit_exceeded: bool,
+}
+
+/// Upper bound of the sandbox time of a whole batch. Each file has its own limit
+/// (`--batchTimeLimit`), this only stops a batch of many slow files.
+const MAX_BATCH_TIME_MS: u64 = 300_000;
+
+/// Outcome of an input whose validator run was stopped at its time limit (not cached)
+fn time_limit_exceeded() -> InputValidation {
+    InputValidation {
+        valid: false,
+        exit_code: -1,
+        message: Some("Validator time limit exceeded".to_string()),
+        overview: None,
+    }
+}
+
+/// Validate many input files with a single validator run (testlib `--batch <list-file>`)
+///
+/// `input_names` are file names inside `input_dir`. Returns the outcome per file, with
+/// its test overview, in the same order. Every file gets the time limit of
+/// `run_validator`, a file exceeding it fails alone; a batch exceeding
+/// `MAX_BATCH_TIME_MS` fails its files with a time limit instead of being rerun.
+pub async fn run_validator_batch(
+    validator_path: &Path,
+    input_dir: &Path,
+    input_names: &[String],
+    timeout_secs: u64,
+) -> Result<Vec<InputValidation>> {
+    info!(
+        "Running validator: {:?} in batch mode on {} inputs",
+        validator_path,
+        input_names.len()
+    );
+
+    let validator_bin = "validator";
+    let list_name = "batch_list.txt";
+    link_or_copy(validator_path, &input_dir.join(validator_bin)).await?;
+    tokio::fs::write(input_dir.join(list_name), input_names.join("\n")).await?;
+
+    // Same per-input limit as run_validator, enforced by testlib in every forked copy
+    let per_input_ms = (timeout_secs * 1000).max(10_000);
+    let time_ms = per_input_ms
+        .saturating_mul(input_names.len().max(1) as u64)
+        .min(MAX_BATCH_TIME_MS.max(per_input_ms)) as u32;
+
+    let spec = ExecutionSpec::new(input_dir)
+        .with_command([
+            format!("./{}", validator_bin),
+            "--batch".to_string(),
+            list_name.to_string(),
+            "--testOverviewLogFileName".to_string(),
+            "overview.log".to_string(),
+            "--batchTimeLimit".to_string(),
+            per_input_ms.to_string(),
+        ])
+        .with_limits(ExecutionLimits {
+            time_ms,
+            memory_mb: 1024,
+        })
+        .with_env_vars(testlib_profile::env_vars());
+
+    let result = crate::engine::executer::execute_sandboxed(&spec)
+        .await
+        .context("Failed to run validator batch in sandbox")?;
+
+    debug!(
+        "Validator batch result: status={:?}, stderr={}",
+        result.status,
+        result.stderr.chars().take(200).collect::<String>()
+    );
+
+    if result.status == ExecutionStatus::TimeLimitExceeded {
+        warn!(
+            "Validator batch exceeded {} ms on {} inputs",
+            time_ms,
+            input_names.len()
+        );
+        return Ok(input_names.iter().map(|_| time_limit_exceeded()).collect());
+    }
+
+    if !result.is_success() {
+        anyhow::bail!(
+            "Validator batch run failed ({:?}): {}",
+            result.status,
+            result.stderr.trim()
+        );
+    }
+
+    // Messages may contain arbitrary bytes of the input, stdout is already lossy UTF-8
+    let entries: Vec<BatchValidationEntry> =
+        serde_json::from_str(&result.stdout).context("Malformed validator batch report")?;
+    if entries.len() != input_names.len()
+        || entries
+            .iter()
+            .zip(input_names)
+            .any(|(e, name)| &e.file != name)
+    {
+        anyhow::bail!("Validator batch report does not match the input list");
+    }
+
+    Ok(entries
+        .into_iter()
+        .map(|e| {
+            if e.time_limit_exceeded {
+                return time_limit_exceeded();
+            }
+            let (message, profile) = testlib_profile::split_testlib_profile(&e.message);
+            if let Some(profile) = profile {
+                info!("Validator profile ({}): {:?}", e.file, profile);
+            }
+            let message = if message.is_empty() {
+                None
+            } else {
+                Some(message)
+            };
+            InputValidation {
+                valid: e.exit_code == validator_exit_codes::OK,
+                exit_code: e.exit_code,
+                message,
+                overview: e.overview.filter(|o| !o.is_empty()),
+            }
+        })
+        .collect())
+}
+
+/// Merge testlib test overviews of several inputs into the overview of all of them,
+/// in testlib's order: bounds hits, features, constant bounds, variables.
+///
+/// A bound is hit (a feature is hit, a name is a variable) if it is in any input;
+/// a constant bound is kept only where every input reporting it agrees, else `?`.
+pub fn merge_overviews<'a>(overviews: impl IntoIterator<Item = &'a str>) -> Option<String> {
+    let mut bounds_hits: BTreeMap<String, (bool, bool)> = BTreeMap::new();
+    let mut features: BTreeMap<String, bool> = BTreeMap::new();
+    let mut constant_bounds: BTreeMap<String, (String, String)> = BTreeMap::new();
+    let mut variables: BTreeSet<String> = BTreeSet::new();
+    let mut other: Vec<String> = vec![];
+    let mut any = false;
+
+    fn merge_bound(merged: &mut String, value: &str) {
+        if merged != value {
+            *merged = "?".to_string();
+        }
+    }
+
+    for overview in overviews {
+        any = true;
+        for line in overview.lines().filter(|l| !l.is_empty()) {
+            if let Some(rest) = line.strip_prefix("feature \"") {
+                if let Some((name, tail)) = rest.rsplit_once("\":") {
+                    *features.entry(name.to_string()).or_default() |= tail.trim() == "hit";
+                    continue;
+                }
+            } else if let Some(rest) = line.strip_prefix("constant-bounds \"") {
+                if let Some((name, tail)) = rest.rsplit_once("\":") {
+                    let mut values = tail.split_whitespace();
+                    let (lower, upper) =
+                        (values.next().unwrap_or("?"), values.next().unwrap_or("?"));
+                    match constant_bounds.get_mut(name) {
+                        Some((merged_lower, merged_upper)) => {
+                            merge_bound(merged_lower, lower);
+                            merge_bound(merged_upper, upper);
+                        }
+                        None => {
+                            constant_bounds
+                                .insert(name.to_string(), (lower.to_string(), upper.to_string()));
+                        }
+                    }
+                    continue;
+                }
+            } else if let Some(rest) = line.strip_prefix("variable \"") {
+                if let Some(name) = rest.strip_suffix('"') {
+                    variables.insert(name.to_string());
+                    continue;
+                }
+            } else if let Some(rest) = line.strip_prefix('"') {
+                if let Some((name, tail)) = rest.rsplit_once("\":") {
+                    let hit = bounds_hits.entry(name.to_string()).or_default();
+                    hit.0 |= tail.contains("min-value-hit");
+                    hit.1 |= tail.contains("max-value-hit");
+                    continue;
+                }
+            }
+            if !other.iter().any(|o| o == line) {
+                other.push(line.to_string());
+            }
+        }
+    }
+
+    if !any {
+        return None;
+    }
+
+    let mut result = String::new();
+    for (name, (min_hit, max_hit)) in &bounds_hits {
+        result += &format!("\"{}\":", name);
+        if *min_hit {
+            result += " min-value-hit";
+        }
+        if *max_hit {
+            result += " max-value-hit";
+        }
+        result += "\n";
+    }
+    for (name, hit) in &features {
+        result += &format!("feature \"{}\":{}\n", name, if *hit { " hit" } else { "" });
+    }
+    for (name, (lower, upper)) in &constant_bounds {
+        if lower != "?" || upper != "?" {
+            result += &format!("constant-bounds \"{}\": {} {}\n", name, lower, upper);
+        }
+    }
+    for name in &variables {
+        result += &format!("variable \"{}\"\n", name);
+    }
+    for line in &other {
+        result += line;
+        result += "\n";
+    }
+    Some(result)
 }
 
 /// Validator manager for handling validator compilation and caching
@@ -151,7 +431,7 @@ impl ValidatorManager {
 
         // Compile or get cached
         self.compiler
-            .get_or_compile(&source_content, problem_id)
+            .get_or_compile(storage, &source_content, problem_id)
             .await
     }
 }
@@ -179,65 +459,163 @@ pub async fn process_validate_job(
                 success: false,
                 testcase_results: vec![],
                 error_message: Some(format!("Failed to compile validator: {}", e)),
+                overview: None,
             });
         }
     };
 
-    let mut testcase_results = Vec::with_capacity(job.testcase_inputs.len());
-    let mut all_valid = true;
+    // Results are cached per (validator binary, input content), so only new or
+    // changed inputs reach the validator.
+    let validator_hash = match tokio::fs::read(&validator_path).await {
+        Ok(bytes) => Some(validation_cache::hash_bytes(&bytes)),
+        Err(e) => {
+            warn!(
+                "Validation cache disabled, can't read validator binary: {}",
+                e
+            );
+            None
+        }
+    };
+
+    let mut results: Vec<Option<TestcaseValidationResult>> =
+        (0..job.testcase_inputs.len()).map(|_| None).collect();
+    // Test overviews of the inputs found valid, cached or validated now
+    let mut overviews: Vec<Option<String>> = vec![None; job.testcase_inputs.len()];
 
     // Create temp directory for input files
     let temp_dir = tempfile::tempdir()?;
 
-    for tc in &job.testcase_inputs {
-        // Download testcase input
-        let input_content = match storage.download_string(&tc.input_path).await {
-            Ok(content) => content,
-            Err(e) => {
-                warn!("Failed to download testcase input {}: {}", tc.id, e);
-                testcase_results.push(TestcaseValidationResult {
+    // Download all inputs first: (index in job, file name in temp_dir, input hash).
+    // Inputs go straight to files (CRLF normalized), hashed on the way: the validator
+    // sees exactly what solutions get on stdin, and no input is held in memory.
+    let mut downloaded: Vec<(usize, String, String)> =
+        Vec::with_capacity(job.testcase_inputs.len());
+    let mut cache_hits = 0;
+    for (idx, tc) in job.testcase_inputs.iter().enumerate() {
+        let input_name = format!("input_{}.txt", tc.id);
+        let input_path = temp_dir.path().join(&input_name);
+        let mut hasher = validation_cache::InputHasher::default();
+        let download =
+            storage.download_to_file(&tc.input_path, &input_path, |chunk| hasher.update(chunk));
+        if let Err(e) = download.await {
+            warn!("Failed to download testcase input {}: {}", tc.id, e);
+            results[idx] = Some(TestcaseValidationResult {
+                testcase_id: tc.id,
+                valid: false,
+                message: Some(format!("Failed to download input: {}", e)),
+            });
+            continue;
+        }
+
+        let input_hash = hasher.finish();
+        if let Some(validator_hash) = &validator_hash {
+            if let Some(cached) = validation_cache::load(validator_hash, &input_hash).await {
+                cache_hits += 1;
+                let _ = tokio::fs::remove_file(&input_path).await;
+                if cached.valid {
+                    overviews[idx] = cached.overview;
+                }
+                results[idx] = Some(TestcaseValidationResult {
                     testcase_id: tc.id,
-                    valid: false,
-                    message: Some(format!("Failed to download input: {}", e)),
+                    valid: cached.valid,
+                    message: cached.message,
                 });
-                all_valid = false;
                 continue;
             }
-        };
+        }
 
-        // Write input to temp file
-        let input_path = temp_dir.path().join(format!("input_{}.txt", tc.id));
-        tokio::fs::write(&input_path, &input_content).await?;
+        downloaded.push((idx, input_name, input_hash));
+    }
+    info!(
+        "Validation cache: {} of {} inputs of problem {} unchanged",
+        cache_hits,
+        job.testcase_inputs.len(),
+        job.problem_id
+    );
 
-        // Run validator
-        match run_validator(&validator_path, &input_path, DEFAULT_VALIDATOR_TIMEOUT_SECS).await {
-            Ok((valid, message)) => {
-                if !valid {
-                    all_valid = false;
-                }
-                testcase_results.push(TestcaseValidationResult {
-                    testcase_id: tc.id,
-                    valid,
-                    message,
-                });
-            }
+    // Validate everything in one validator process; validators that do not take
+    // `registerValidation(argc, argv)` arguments fall back to one run per input.
+    let input_names: Vec<String> = downloaded.iter().map(|(_, name, _)| name.clone()).collect();
+    let batch = if input_names.is_empty() {
+        Some(vec![])
+    } else {
+        match run_validator_batch(
+            &validator_path,
+            temp_dir.path(),
+            &input_names,
+            DEFAULT_VALIDATOR_TIMEOUT_SECS,
+        )
+        .await
+        {
+            Ok(batch) => Some(batch),
             Err(e) => {
-                warn!("Validator error for testcase {}: {}", tc.id, e);
-                testcase_results.push(TestcaseValidationResult {
-                    testcase_id: tc.id,
-                    valid: false,
-                    message: Some(format!("Validator error: {}", e)),
-                });
-                all_valid = false;
+                warn!(
+                    "Validator batch mode failed for problem {}, validating one by one: {:#}",
+                    job.problem_id, e
+                );
+                None
+            }
+        }
+    };
+
+    // Per input: the outcome, or an error message if the validator could not be run
+    let outcomes: Vec<Result<InputValidation, String>> = match batch {
+        Some(batch) => batch.into_iter().map(Ok).collect(),
+        None => {
+            let mut outcomes = Vec::with_capacity(downloaded.len());
+            for (idx, input_name, _) in &downloaded {
+                let tc = &job.testcase_inputs[*idx];
+                let input_path = temp_dir.path().join(input_name);
+
+                // Run validator
+                let outcome =
+                    run_validator(&validator_path, &input_path, DEFAULT_VALIDATOR_TIMEOUT_SECS)
+                        .await
+                        .map_err(|e| {
+                            warn!("Validator error for testcase {}: {}", tc.id, e);
+                            format!("Validator error: {}", e)
+                        });
+                outcomes.push(outcome);
             }
+            outcomes
         }
+    };
+
+    for ((idx, _, input_hash), outcome) in downloaded.iter().zip(outcomes) {
+        let testcase_id = job.testcase_inputs[*idx].id;
+        results[*idx] = Some(match outcome {
+            Ok(outcome) => {
+                if let Some(validator_hash) = &validator_hash {
+                    if outcome.is_cacheable() {
+                        validation_cache::store(validator_hash, input_hash, &outcome).await;
+                    }
+                }
+                if outcome.valid {
+                    overviews[*idx] = outcome.overview;
+                }
+                TestcaseValidationResult {
+                    testcase_id,
+                    valid: outcome.valid,
+                    message: outcome.message,
+                }
+            }
+            Err(message) => TestcaseValidationResult {
+                testcase_id,
+                valid: false,
+                message: Some(message),
+            },
+        });
     }
 
+    let testcase_results: Vec<TestcaseValidationResult> = results.into_iter().flatten().collect();
+    let all_valid = testcase_results.iter().all(|r| r.valid);
+
     Ok(ValidateResult {
         problem_id: job.problem_id,
         success: all_valid,
         testcase_results,
         error_message: None,
+        overview: merge_overviews(overviews.iter().flatten().map(String::as_str)),
     })
 }
 
@@ -262,4 +640,74 @@ mod tests {
         assert_eq!(parsed.problem_id, 1);
         assert_eq!(parsed.testcase_inputs.len(), 1);
     }
+
+    #[test]
+    fn test_batch_report_deserialization() {
+        let report = r#"[
+{"file": "input_1.txt", "exitCode": 0, "message": ""},
+{"file": "input_2.txt", "exitCode": 3, "message": "FAIL Expected EOLN (stdin, line 1)"}
+]"#;
+        let entries: Vec<BatchValidationEntry> = serde_json::from_str(report).unwrap();
+
+        assert_eq!(entries.len(), 2);
+        assert_eq!(entries[0].file, "input_1.txt");
+        assert_eq!(entries[0].exit_code, validator_exit_codes::OK);
+        assert_eq!(entries[1].exit_code, validator_exit_codes::FAIL);
+        assert!(entries[1].message.starts_with("FAIL"));
+        assert!(entries[0].overview.is_none());
+        assert!(!entries[0].time_limit_exceeded);
+    }
+
+    #[test]
+    fn test_batch_report_time_limit_deserialization() {
+        let report = r#"[
+{"file": "input_1.txt", "exitCode": -1, "message": "", "timeLimitExceeded": true, "overview": ""}
+]"#;
+        let entries: Vec<BatchValidationEntry> = serde_json::from_str(report).unwrap();
+
+        assert!(entries[0].time_limit_exceeded);
+        assert!(!time_limit_exceeded().is_cacheable());
+    }
+
+    #[test]
+    fn test_batch_report_overview_deserialization() {
+        let report = r#"[
+{"file": "input_1.txt", "exitCode": 0, "message": "", "overview": "\"n\": min-value-hit\n"}
+]"#;
+        let entries: Vec<BatchValidationEntry> = serde_json::from_str(report).unwrap();
+
+        assert_eq!(
+            entries[0].overview.as_deref(),
+            Some("\"n\": min-value-hit\n")
+        );
+    }
+
+    #[test]
+    fn test_merge_overviews() {
+        let first = "\"n\": min-value-hit\nfeature \"big\":\nconstant-bounds \"m\": 1 5\nconstant-bounds \"n\": 1 10\nvariable \"n\"\n";
+        let second = "\"k\":\n\"n\": max-value-hit\nfeature \"big\": hit\nconstant-bounds \"m\": 2 6\nconstant-bounds \"n\": 1 10\nvariable \"k\"\nvariable \"n\"\n";
+
+        assert_eq!(merge_overviews([first]).as_deref(), Some(first));
+        assert_eq!(
+            merge_overviews([first, second]).as_deref(),
+            Some(
+                "\"k\":\n\"n\": min-value-hit max-value-hit\nfeature \"big\": hit\nconstant-bounds \"n\": 1 10\nvariable \"k\"\nvariable \"n\"\n"
+            )
+        );
+        assert!(merge_overviews(std::iter::empty()).is_none());
+    }
+
+    #[test]
+    fn test_input_validation_cacheability() {
+        let outcome = |exit_code| InputValidation {
+            valid: exit_code == validator_exit_codes::OK,
+            exit_code,
+            message: None,
+            overview: None,
+        };
+
+        assert!(outcome(validator_exit_codes::OK).is_cacheable());
+        assert!(!outcome(validator_exit_codes::FAIL).is_cacheable());
+        assert!(!outcome(-1).is_cacheable());
+    }
 }
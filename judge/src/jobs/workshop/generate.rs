@@ -198,7 +198,50 @@ pub async fn process_workshop_generate_job(
     let runtime_flags =
         crate::engine::compiler::include_flags::format_include_flags(&job.language, &include_dirs);
 
-    // 4. Execute in sandbox.
+    // 4. Output cache: the compiled work dir + run command determine the
+    //    output, so an unchanged generator/args/seed reuses the stored one.
+    let output_key = match super::compile_cache::read_resource_files(work_dir).await {
+        Ok(files) => Some(super::generate_cache::compute_key(
+            &files,
+            &job.language,
+            &run_cmd,
+        )),
+        Err(e) => {
+            warn!(
+                "generate_cache: can't read work dir {:?}: {:#}",
+                work_dir, e
+            );
+            None
+        }
+    };
+    if let Some(key) = &output_key {
+        if let Some(cached) = super::generate_cache::try_restore(
+            storage,
+            job.problem_id,
+            key,
+            &job.output_path,
+            job.time_limit_ms,
+            job.memory_limit_mb,
+        )
+        .await
+        {
+            return Ok(WorkshopGenerateResult {
+                job_id: job.job_id.clone(),
+                problem_id: job.problem_id,
+                testcase_index: job.testcase_index,
+                success: true,
+                output_path: Some(job.output_path.clone()),
+                stdout_preview: cached.stdout_preview,
+                stderr: cached.stderr,
+                exit_code: 0,
+                time_ms: cached.time_ms,
+                memory_kb: cached.memory_kb,
+                compile_message: None,
+            });
+        }
+    }
+
+    // 5. Execute in sandbox.
     let spec = ExecutionSpec::new(work_dir)
         .with_command(&run_cmd)
         .with_limits(ExecutionLimits {
@@ -247,7 +290,7 @@ pub async fn process_workshop_generate_job(
         )
     };
 
-    // 5. On success, upload stdout as the testcase input.
+    // 6. On success, upload stdout as the testcase input.
     let output_path = if success {
         // Upload raw bytes to preserve binary-accurate content if any.
         if let Err(e) = storage
@@ -269,6 +312,21 @@ pub async fn process_workshop_generate_job(
                 compile_message: None,
             });
         }
+        if let Some(key) = &output_key {
+            super::generate_cache::save(
+                storage,
+                job.problem_id,
+                key,
+                &job.output_path,
+                &super::generate_cache::CachedGeneration {
+                    stdout_preview: stdout_preview.clone(),
+                    stderr: outcome.stderr.clone(),
+                    time_ms: outcome.time_ms,
+                    memory_kb: outcome.memory_kb,
+                },
+            )
+            .await;
+        }
         Some(job.output_path.clone())
     } else {
         None
@@ -0,0 +1,197 @@
+//! Workshop generator output cache — keyed by everything the output depends on.
+//!
+//! testlib generators (`registerGen(argc, argv, 1)`) are deterministic:
+//! `random_t::setSeed` is derived from argv, which ends with the injected seed.
+//! So the output is a function of the program (compiled binary, source and
+//! resources — testlib.h included), the language and the run command. An
+//! unchanged generator, argv and seed reuse the stored output instead of
+//! running again. Entries live in MinIO so every worker shares them, under the
+//! problem prefix so they are dropped with the problem:
+//!
+//!   workshop/{problem_id}/generator_cache/{sha256}/output     raw stdout
+//!   workshop/{problem_id}/generator_cache/{sha256}/meta.json  preview, stderr, usage
+//!
+//! `meta.json` is written last, an entry without it is ignored.
+
+use serde::{Deserialize, Serialize};
+use sha2::{Digest, Sha256};
+use tracing::{info, warn};
+
+use crate::infra::storage::StorageClient;
+
+/// Everything besides the output that a cache hit has to report
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct CachedGeneration {
+    pub stdout_preview: Option<String>,
+    pub stderr: String,
+    pub time_ms: u32,
+    pub memory_kb: u32,
+}
+
+/// Compute the cache key from the work dir files after compilation (name +
+/// content), the language and the full run command (user args + seed).
+/// Returns hex.
+pub fn compute_key(files: &[(String, Vec<u8>)], language: &str, run_cmd: &[String]) -> String {
+    let mut hasher = Sha256::new();
+    hasher.update(b"--LANG--\n");
+    hasher.update(language.as_bytes());
+    hasher.update(b"\n--RUN_CMD--\n");
+    for tok in run_cmd {
+        hasher.update((tok.len() as u64).to_le_bytes());
+        hasher.update(tok.as_bytes());
+    }
+    hasher.update(b"\n--FILES--\n");
+    let mut sorted: Vec<&(String, Vec<u8>)> = files.iter().collect();
+    sorted.sort_by(|a, b| a.0.cmp(&b.0));
+    for (name, bytes) in sorted {
+        hasher.update((name.len() as u64).to_le_bytes());
+        hasher.update(name.as_bytes());
+        hasher.update((bytes.len() as u64).to_le_bytes());
+        hasher.update(bytes);
+    }
+    format!("{:x}", hasher.finalize())
+}
+
+fn entry_prefix(problem_id: i64, key: &str) -> String {
+    format!("workshop/{}/generator_cache/{}", problem_id, key)
+}
+
+/// If an entry exists for `key` whose run fits the current limits, copy its
+/// output to `output_path` and return its metadata. Any failure is a miss.
+pub async fn try_restore(
+    storage: &StorageClient,
+    problem_id: i64,
+    key: &str,
+    output_path: &str,
+    time_limit_ms: u32,
+    memory_limit_mb: u32,
+) -> Option<CachedGeneration> {
+    let prefix = entry_prefix(problem_id, key);
+    let meta_bytes = storage
+        .download(&format!("{}/meta.json", prefix))
+        .await
+        .ok()?;
+    let meta: CachedGeneration = match serde_json::from_slice(&meta_bytes) {
+        Ok(meta) => meta,
+        Err(e) => {
+            warn!("generate_cache: malformed meta for {}: {:#}", prefix, e);
+            return None;
+        }
+    };
+    // The stored run must also have succeeded under the limits asked for now
+    if meta.time_ms > time_limit_ms || meta.memory_kb > memory_limit_mb.saturating_mul(1024) {
+        return None;
+    }
+    if let Err(e) = storage
+        .copy(&format!("{}/output", prefix), output_path)
+        .await
+    {
+        warn!("generate_cache: restore {}: {:#}", prefix, e);
+        return None;
+    }
+    info!(
+        "Workshop generator cache HIT ({})",
+        &key[..12.min(key.len())]
+    );
+    Some(meta)
+}
+
+/// Best-effort populate an entry from an output already uploaded to
+/// `output_path`. Logs and swallows errors (caching is an optimization, not a
+/// correctness requirement).
+pub async fn save(
+    storage: &StorageClient,
+    problem_id: i64,
+    key: &str,
+    output_path: &str,
+    meta: &CachedGeneration,
+) {
+    let prefix = entry_prefix(problem_id, key);
+    if let Err(e) = storage
+        .copy(output_path, &format!("{}/output", prefix))
+        .await
+    {
+        warn!("generate_cache: save output {}: {:#}", prefix, e);
+        return;
+    }
+    let meta_bytes = match serde_json::to_vec(meta) {
+        Ok(bytes) => bytes,
+        Err(e) => {
+            warn!("generate_cache: serialize meta {}: {:#}", prefix, e);
+            return;
+        }
+    };
+    if let Err(e) = storage
+        .upload(&format!("{}/meta.json", prefix), meta_bytes)
+        .await
+    {
+        warn!("generate_cache: save meta {}: {:#}", prefix, e);
+        return;
+    }
+    info!(
+        "Workshop generator cache MISS — populated ({})",
+        &key[..12.min(key.len())]
+    );
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn cmd(toks: &[&str]) -> Vec<String> {
+        toks.iter().map(|s| s.to_string()).collect()
+    }
+
+    #[test]
+    fn compute_key_is_order_independent_for_files() {
+        let a = compute_key(
+            &[
+                ("Main".into(), b"1".to_vec()),
+                ("testlib.h".into(), b"2".to_vec()),
+            ],
+            "cpp",
+            &cmd(&["./Main", "10", "a3f7c2"]),
+        );
+        let b = compute_key(
+            &[
+                ("testlib.h".into(), b"2".to_vec()),
+                ("Main".into(), b"1".to_vec()),
+            ],
+            "cpp",
+            &cmd(&["./Main", "10", "a3f7c2"]),
+        );
+        assert_eq!(a, b);
+    }
+
+    #[test]
+    fn compute_key_changes_when_seed_changes() {
+        let files = [("Main".to_string(), b"1".to_vec())];
+        let a = compute_key(&files, "cpp", &cmd(&["./Main", "10", "a3f7c2"]));
+        let b = compute_key(&files, "cpp", &cmd(&["./Main", "10", "a3f7c3"]));
+        assert_ne!(a, b);
+    }
+
+    #[test]
+    fn compute_key_keeps_argument_boundaries() {
+        let files = [("Main".to_string(), b"1".to_vec())];
+        let a = compute_key(&files, "cpp", &cmd(&["./Main", "1", "23"]));
+        let b = compute_key(&files, "cpp", &cmd(&["./Main", "12", "3"]));
+        assert_ne!(a, b);
+    }
+
+    #[test]
+    fn compute_key_changes_when_testlib_changes() {
+        let run = cmd(&["./Main", "a3f7c2"]);
+        let a = compute_key(&[("testlib.h".into(), b"v1".to_vec())], "cpp", &run);
+        let b = compute_key(&[("testlib.h".into(), b"v2".to_vec())], "cpp", &run);
+        assert_ne!(a, b);
+    }
+
+    #[test]
+    fn entry_prefix_is_under_problem() {
+        assert_eq!(
+            entry_prefix(42, "deadbeef"),
+            "workshop/42/generator_cache/deadbeef"
+        );
+    }
+}
@@ -9,7 +9,10 @@ use tracing::{info, warn};
 use crate::components::checker::{run_checker, DEFAULT_CHECKER_TIMEOUT_SECS};
 use crate::core::languages;
 use crate::core::verdict::Verdict;
-use crate::engine::compiler::{compile_in_sandbox, compile_on_host, compile_trusted_cpp};
+use crate::engine::compiler::{
+    compile_in_sandbox, compile_on_host, compile_trusted_cpp, matches_precompiled_testlib,
+    testlib_pch_dir,
+};
 use crate::engine::executer::{execute_sandboxed, ExecutionLimits, ExecutionSpec, ExecutionStatus};
 use crate::engine::sandbox::get_config;
 use crate::infra::storage::StorageClient;
@@ -459,7 +462,10 @@ async fn run_workshop_cpp_checker(
     // Copy draft resources (testlib.h, custom headers) into the checker
     // sandbox box. Sandbox only mounts `checker_dir`, so resources at
     // `parent_work_dir` root are inaccessible without this copy.
+    // An unmodified testlib.h is left out of the box so g++ picks up the
+    // precompiled one instead (it is still hashed as a resource below).
     let mut resource_files: Vec<(String, Vec<u8>)> = Vec::new();
+    let mut uses_testlib_pch = false;
     let mut entries = tokio::fs::read_dir(parent_work_dir).await?;
     while let Some(entry) = entries.next_entry().await? {
         let path = entry.path();
@@ -475,7 +481,11 @@ async fn run_workshop_cpp_checker(
             continue; // don't clobber checker.cpp itself
         }
         let bytes = tokio::fs::read(&path).await?;
-        tokio::fs::write(&dest, &bytes).await?;
+        if name == "testlib.h" && matches_precompiled_testlib(&bytes).await {
+            uses_testlib_pch = true;
+        } else {
+            tokio::fs::write(&dest, &bytes).await?;
+        }
         resource_files.push((name.to_string(), bytes));
     }
 
@@ -501,7 +511,11 @@ async fn run_workshop_cpp_checker(
         // Resources were just copied flat into checker_dir (the sandbox box
         // work_dir), so `-I.` is what the contract wants — see
         // compile_trusted_cpp's docstring.
-        let tc = compile_trusted_cpp(&src_path, &bin_path, &[Path::new(".")]).await?;
+        let mut include_paths = vec![Path::new(".")];
+        if uses_testlib_pch {
+            include_paths.extend(testlib_pch_dir());
+        }
+        let tc = compile_trusted_cpp(&src_path, &bin_path, &include_paths).await?;
         if !tc.success {
             anyhow::bail!("Checker compile failed: {}", tc.stderr);
         }
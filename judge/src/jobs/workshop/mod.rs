@@ -119,6 +119,7 @@
 
 pub mod compile_cache;
 pub mod generate;
+pub mod generate_cache;
 pub mod invoke;
 pub mod validate;
 
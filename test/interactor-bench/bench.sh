@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# 인터랙터와 솔루션을 파이프로 연결해 Q개의 질의를 주고받고 초당 질의 수를 출력한다.
+# 사용법: ./bench.sh [Q]  (먼저 make build)
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+Q="${1:-200000}"
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+echo "$Q" > "$WORK_DIR/input.txt"
+mkfifo "$WORK_DIR/to_solution" "$WORK_DIR/to_interactor"
+
+START=$(date +%s.%N)
+"$SCRIPT_DIR/solution" < "$WORK_DIR/to_solution" > "$WORK_DIR/to_interactor" &
+SOLUTION_PID=$!
+# fifo 는 반대편이 열릴 때까지 open 이 막히므로 솔루션과 같은 순서(to_solution 먼저)로 연다
+"$SCRIPT_DIR/interactor" "$WORK_DIR/input.txt" "$WORK_DIR/tout.txt" \
+    > "$WORK_DIR/to_solution" < "$WORK_DIR/to_interactor" 2> "$WORK_DIR/verdict.txt"
+INTERACTOR_EXIT=$?
+wait "$SOLUTION_PID"
+END=$(date +%s.%N)
+
+echo "verdict: $(cat "$WORK_DIR/verdict.txt") (exit $INTERACTOR_EXIT)"
+awk -v q="$Q" -v s="$START" -v e="$END" \
+    'BEGIN { printf "%d queries in %.3fs: %.0f queries/sec\n", q, e - s, q / (e - s) }'
@@ -0,0 +1,19 @@
+#include "testlib.h"
+
+// 입력: 질의 수 q. 매 질의마다 두 수를 보내고 참가자에게서 합을 받는다.
+int main(int argc, char *argv[]) {
+    registerInteraction(argc, argv);
+    int q = inf.readInt();
+    println(q);
+    long long check = 0;
+    for (int i = 0; i < q; i++) {
+        long long a = i, b = 1000000007LL - i;
+        println(a, b);
+        long long sum = ouf.readLong();
+        if (sum != a + b)
+            quitf(_wa, "query %d: expected %lld, found %lld", i + 1, a + b, sum);
+        check += sum;
+    }
+    tout << check << std::endl;
+    quitf(_ok, "%d queries", q);
+}
@@ -0,0 +1,16 @@
+#include <cstdio>
+
+// 대회 참가자처럼 scanf/printf + fflush 로 응답한다.
+int main() {
+    int q;
+    if (scanf("%d", &q) != 1)
+        return 1;
+    for (int i = 0; i < q; i++) {
+        long long a, b;
+        if (scanf("%lld %lld", &a, &b) != 2)
+            return 1;
+        printf("%lld\n", a + b);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#!/bin/bash
+
+# 코퍼스를 만들고 testlib 읽기/패턴/난수, 번들 체커, 검증기의 처리량을 출력한다.
+# 사용법: ./bench.sh [SIZE...]  (먼저 make build, SIZE 는 1k 10m 500m 처럼, 기본 1k 10m)
+# 코퍼스는 $CORPUS_DIR (기본 /tmp/testlib-bench) 에 한 번 만들어 두고 다시 쓴다 — 다른 testlib.h 와
+# 비교할 때도 같은 입력으로 잰다. gen.cpp 를 바꿨다면 $CORPUS_DIR 을 지운다.
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+CORPUS_DIR="${CORPUS_DIR:-/tmp/testlib-bench}"
+SIZES=("$@")
+[ ${#SIZES[@]} -eq 0 ] && SIZES=(1k 10m)
+KINDS=(ints tokens floats)
+
+mkdir -p "$CORPUS_DIR"
+
+to_bytes() {
+    local size="${1,,}"
+    case "$size" in
+        *k) echo $(( ${size%k} * 1000 )) ;;
+        *m) echo $(( ${size%m} * 1000000 )) ;;
+        *g) echo $(( ${size%g} * 1000000000 )) ;;
+        *) echo "$size" ;;
+    esac
+}
+
+now_ns() {
+    date +%s%N
+}
+
+row() {
+    printf "%-22s %-14s %12s %14s\n" "$@"
+}
+
+# 프로세스 하나를 되풀이해 실행한다, 작은 코퍼스는 시작 비용이 보이도록 여러 번.
+# PIPED=1 이면 코퍼스 파일을 파이프로 stdin 에 흘려 넣는다 (스트리밍 체커의 출력 경로)
+run_process() {
+    local name="$1" file="$2"
+    shift 2
+    local bytes tokens reps start end
+    bytes=$(stat -c %s "$file")
+    tokens=$(( $(head -c 32 "$file" | awk 'NR == 1 { print $1 }') + 2 ))
+    reps=$(( 20000000 / bytes ))
+    [ "$reps" -lt 1 ] && reps=1
+    [ "$reps" -gt 200 ] && reps=200
+
+    start=$(now_ns)
+    for ((i = 0; i < reps; i++)); do
+        if [ -n "$PIPED" ]; then
+            cat "$file" | "$@" > /dev/null 2>"$CORPUS_DIR/stderr.txt"
+        else
+            "$@" > /dev/null 2>"$CORPUS_DIR/stderr.txt"
+        fi
+        if [ $? -ne 0 ]; then
+            echo "$name failed on $file: $(cat "$CORPUS_DIR/stderr.txt")" >&2
+            return
+        fi
+    done
+    end=$(now_ns)
+
+    awk -v n="$name" -v c="$(basename "$file" .txt)" -v b="$bytes" -v t="$tokens" -v r="$reps" \
+        -v s="$start" -v e="$end" \
+        'BEGIN { sec = (e - s) / 1E9; printf "%-22s %-14s %12.1f %14.0f\n", n, c, b * r / sec / 1E6, t * r / sec }'
+}
+
+for size in "${SIZES[@]}"; do
+    bytes=$(to_bytes "$size")
+    for kind in "${KINDS[@]}"; do
+        file="$CORPUS_DIR/$kind-$size.txt"
+        if [ ! -f "$file" ]; then
+            echo "generating $file" >&2
+            "$SCRIPT_DIR/gen" "$kind" "$bytes" 1 > "$file.tmp" && mv "$file.tmp" "$file"
+        fi
+    done
+done
+
+row "case" "corpus" "MB/s" "tokens/s"
+for size in "${SIZES[@]}"; do
+    for kind in "${KINDS[@]}"; do
+        file="$CORPUS_DIR/$kind-$size.txt"
+        cases=(readWord readLine)
+        [ "$kind" = ints ] && cases+=(readInt)
+        [ "$kind" = floats ] && cases+=(readDouble)
+        [ "$kind" = tokens ] && cases+=(pattern)
+        for c in "${cases[@]}"; do
+            "$SCRIPT_DIR/readers" "$c" "$file"
+        done
+
+        # 체커는 같은 파일을 출력과 정답으로 받아 끝까지 비교한다. "(pipe)" 는 채점기의 스트리밍
+        # 모드처럼 출력을 "-" 로 주고 파이프로 읽힌다. testlib 체커는 128 MiB 보다 큰 파일을 열지
+        # 않으므로 (InStream::maxFileSize) 정답이 그보다 큰 크기에서는 둘 다 건너뛴다
+        if [ "$(stat -c %s "$file")" -le $((128 * 1024 * 1024)) ]; then
+            checkers=(wcmp icpc_diff)
+            [ "$kind" != tokens ] && checkers+=(rcmp4)
+            for checker in "${checkers[@]}"; do
+                run_process "$checker" "$file" "$SCRIPT_DIR/$checker" "$file" "$file" "$file"
+                PIPED=1 run_process "$checker (pipe)" "$file" "$SCRIPT_DIR/$checker" "$file" - "$file"
+            done
+        fi
+        run_process validator "$file" "$SCRIPT_DIR/validator" --inputFile "$file"
+    done
+done
+
+"$SCRIPT_DIR/readers" rnd 10000000
@@ -0,0 +1,49 @@
+#include "testlib.h"
+using namespace std;
+
+// 벤치마크 코퍼스 생성기
+// 사용법: ./gen <ints|tokens|floats> <bytes> <seed>
+//
+// 첫 줄은 "n kind" (kind 0 = ints, 1 = tokens, 2 = floats), 이어서 값 n개.
+// 크기는 값의 평균 길이로 n 을 정하므로 bytes 에 가깝지만 정확하지는 않다.
+//   ints   : [-10^9, 10^9] 정수, 한 줄에 16개
+//   tokens : 길이 100..1000 의 영소문자 토큰, 한 줄에 1개
+//   floats : [-10^6, 10^6] 실수 (소수점 아래 6자리), 한 줄에 8개
+int main(int argc, char* argv[]) {
+    registerGen(argc, argv, 1);
+
+    string kind = opt<string>(1);
+    long long bytes = opt<long long>(2);
+
+    int kindId, perLine;
+    double averageLength;
+    if (kind == "ints")
+        kindId = 0, perLine = 16, averageLength = 10.4;
+    else if (kind == "tokens")
+        kindId = 1, perLine = 1, averageLength = 551.0;
+    else if (kind == "floats")
+        kindId = 2, perLine = 8, averageLength = 14.4;
+    else
+        quitf(_fail, "unknown corpus kind: %s", kind.c_str());
+
+    int n = int(max(1.0, min(1E9, double(bytes) / averageLength)));
+    fastout << n << ' ' << kindId << '\n';
+    fastout.setPrecision(6);
+
+    string token;
+    for (int i = 0; i < n; i++) {
+        if (kindId == 0) {
+            fastout << rnd.next(-1000000000, 1000000000);
+        } else if (kindId == 1) {
+            token.resize(rnd.next(100, 1000));
+            for (char &c : token)
+                c = char('a' + rnd.next(26));
+            fastout << token;
+        } else {
+            fastout << rnd.next(-1E6, 1E6);
+        }
+        fastout << (i + 1 == n || (i + 1) % perLine == 0 ? '\n' : ' ');
+    }
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "testlib.h"
+#include <chrono>
+using namespace std;
+
+// testlib 프로세스 내부 벤치마크
+// 사용법: ./readers <readWord|readInt|readDouble|readLine|pattern> <corpus>
+//         ./readers rnd <count>
+//
+// 한 줄에 "<case> <corpus> <MB/s> <tokens/s>" 를 출력한다 (bench.sh 의 표 형식). 읽기 케이스는 비엄격 모드 InStream 으로
+// 코퍼스 전체를 읽고, 누적 0.3초가 될 때까지 되풀이한 평균이다.
+
+static double now() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const string &name, const string &corpus, double bytes, double tokens, double seconds) {
+    if (bytes > 0)
+        printf("%-22s %-14s %12.1f %14.0f\n", name.c_str(), corpus.c_str(), bytes / seconds / 1E6, tokens / seconds);
+    else
+        printf("%-22s %-14s %12s %14.0f\n", name.c_str(), corpus.c_str(), "-", tokens / seconds);
+}
+
+// "/tmp/testlib-bench/ints-10m.txt" -> "ints-10m"
+static string corpusName(const string &fileName) {
+    string name = fileName.substr(fileName.find_last_of('/') + 1);
+    return name.substr(0, name.find_last_of('.'));
+}
+
+// 결과를 쓰지 않으면 컴파일러가 읽기를 지울 수 있다
+static volatile long long sink;
+
+// 500 MB 코퍼스도 읽도록 testlib 의 128 MB 제한을 푼다
+static void openCorpus(InStream &s, const string &fileName) {
+    s.maxFileSize = numeric_limits<size_t>::max();
+    s.init(fileName, _input);
+}
+
+static long long readPass(const string &name, const string &fileName) {
+    InStream s;
+    openCorpus(s, fileName);
+    long long tokens = 0, check = 0;
+    if (name == "readWord") {
+        for (; !s.seekEof(); tokens++)
+            check += s.readWord().length();
+    } else if (name == "readInt") {
+        for (; !s.seekEof(); tokens++)
+            check += s.readInt();
+    } else if (name == "readDouble") {
+        for (; !s.seekEof(); tokens++)
+            check += (long long) s.readDouble();
+    } else if (name == "readLine") {
+        for (; !s.eof(); tokens++)
+            check += s.readLine().length();
+    } else {
+        quitf(_fail, "unknown case: %s", name.c_str());
+    }
+    s.close();
+    sink = check;
+    return tokens;
+}
+
+// 토큰을 4096개씩 읽어 두고 pattern::matches 만 잰다
+static double patternPass(const string &fileName, double &bytes, double &tokens) {
+    static const pattern p("[a-z]{1,1000}");
+    InStream s;
+    openCorpus(s, fileName);
+    vector<string> block;
+    double seconds = 0;
+    long long matched = 0;
+    while (!s.seekEof()) {
+        block.clear();
+        while (block.size() < 4096 && !s.seekEof())
+            block.push_back(s.readWord());
+
+        double start = now();
+        for (const string &token : block)
+            matched += p.matches(token);
+        seconds += now() - start;
+
+        for (const string &token : block)
+            bytes += double(token.length());
+        tokens += double(block.size());
+    }
+    s.close();
+    sink = matched;
+    return seconds;
+}
+
+static void benchRandom(int count) {
+    long long check = 0;
+    double start = now();
+    for (int i = 0; i < count; i++)
+        check += rnd.next(1, 1000000000);
+    report("rnd.next(1, 10^9)", "-", 0, count, now() - start);
+
+    start = now();
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += rnd.next(1.0);
+    report("rnd.next(1.0)", "-", 0, count, now() - start);
+
+    int strings = max(1, count / 16);
+    start = now();
+    for (int i = 0; i < strings; i++)
+        check += rnd.next("[a-z]{16}").length();
+    report("rnd.next(\"[a-z]{16}\")", "-", 16.0 * strings, strings, now() - start);
+
+    start = now();
+    check += rnd.perm(count)[count / 2];
+    report("rnd.perm(count)", "-", 0, count, now() - start);
+
+    sink = check + (long long) sum;
+}
+
+int main(int argc, char* argv[]) {
+    registerGen(argc, argv, 1);
+
+    string name = opt<string>(1);
+    if (name == "rnd") {
+        benchRandom(opt<int>(2));
+        return 0;
+    }
+
+    string fileName = opt<string>(2);
+    double bytes = 0, tokens = 0, seconds = 0;
+    if (name == "pattern") {
+        double start = now();
+        do
+            seconds += patternPass(fileName, bytes, tokens);
+        while (now() - start < 0.3);
+    } else {
+        double fileSize;
+        {
+            FILE *f = fopen(fileName.c_str(), "rb");
+            if (f == NULL)
+                quitf(_fail, "can't open %s", fileName.c_str());
+            fseek(f, 0, SEEK_END);
+            fileSize = double(ftell(f));
+            fclose(f);
+        }
+        double start = now();
+        do {
+            tokens += double(readPass(name, fileName));
+            bytes += fileSize;
+            seconds = now() - start;
+        } while (seconds < 0.3);
+    }
+    report(name, corpusName(fileName), bytes, tokens, seconds);
+
+    return 0;
+}
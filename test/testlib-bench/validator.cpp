@@ -0,0 +1,33 @@
+// 벤치마크 코퍼스 검증기 — workshop 검증기 템플릿과 같은 형태 (stdin 을 읽고 readEof 로 끝난다)
+//
+// gen.cpp 가 만드는 형식을 엄격하게 확인한다: 첫 줄 "n kind", 이어서 kind 에 따라
+// 한 줄에 16개의 정수, 1개의 토큰 (패턴 엔진으로 확인), 8개의 실수.
+
+#include "testlib.h"
+
+int main(int argc, char *argv[]) {
+    registerValidation(argc, argv);
+
+    int n = inf.readInt(1, 1000000000, "n");
+    inf.readSpace();
+    int kind = inf.readInt(0, 2, "kind");
+    inf.readEoln();
+
+    int perLine = kind == 0 ? 16 : kind == 1 ? 1 : 8;
+    for (int i = 0; i < n; i++) {
+        if (kind == 0)
+            inf.readInt(-1000000000, 1000000000, "a");
+        else if (kind == 1)
+            inf.readToken("[a-z]{1,1000}", "s");
+        else
+            inf.readDouble(-1E6, 1E6, "x");
+
+        if (i + 1 == n || (i + 1) % perLine == 0)
+            inf.readEoln();
+        else
+            inf.readSpace();
+    }
+    inf.readEof();
+
+    return 0;
+}
@@ -25,6 +25,7 @@ interface ValidationResults {
 	success: boolean;
 	testcase_results: TestcaseValidationResult[];
 	error_message?: string | null;
+	overview?: string | null;
 }
 
 const DEFAULT_VALIDATOR_TEMPLATE = `#include "testlib.h"
@@ -215,6 +216,15 @@ export function ValidatorUploadForm({
 					</div>
 				)}
 
+				{validationResults?.overview && (
+					<div className="space-y-2">
+						<h4 className="text-sm font-medium">테스트 개요 (경계값, 특징):</h4>
+						<pre className="p-3 rounded-md bg-muted font-mono text-xs whitespace-pre-wrap max-h-[200px] overflow-y-auto">
+							{validationResults.overview}
+						</pre>
+					</div>
+				)}
+
 				{validationResults?.error_message && (
 					<div className="p-3 rounded-md bg-[var(--verdict-wrong-bg)] border border-[var(--verdict-wrong)]">
 						<p className="text-sm text-[var(--verdict-wrong)] font-mono whitespace-pre-wrap">
@@ -4,35 +4,11 @@
 // (https://github.com/MikeMirzayanov/testlib/blob/master/checkers/rcmp4.cpp).
 #include "testlib.h"
 
-#include <cmath>
-#include <cstdio>
-
 const double EPS = 1E-4;
 
 int main(int argc, char *argv[]) {
     setName("compare two sequences of doubles, max absolute or relative error = %.10f", EPS);
-    registerTestlibCmd(argc, argv);
-
-    int n = 0;
-    while (!ans.seekEof()) {
-        n++;
-        double j = ans.readDouble();
-        double p = ouf.readDouble();
-
-        double diff = std::fabs(j - p);
-        double scale = std::fabs(j);
-        if (scale < 1.0) scale = 1.0;
-
-        if (diff > EPS && diff / scale > EPS) {
-            quitf(_wa,
-                  "%d%s numbers differ - expected: '%.10f', found: '%.10f', error = '%.10f'",
-                  n,
-                  englishEnding(n).c_str(),
-                  j,
-                  p,
-                  diff);
-        }
-    }
+    registerTestlibStream(argc, argv);
 
-    quitf(_ok, "%d number(s)", n);
+    testlib::compare<testlib::Words, testlib::CaseSensitive, testlib::Doubles<4>, testlib::DefaultTrailing>(ans, ouf);
 }
@@ -6,13 +6,15 @@ using namespace std;
 int main(int argc, char* argv[]) {
     registerGen(argc, argv, 1);
 
+    // fastout buffers the output (cout << endl flushes on every line).
+    // Call fastout.flush() before writing with cout/printf directly.
     int n = rnd.next(1, 100);
-    cout << n << endl;
+    fastout << n << '\n';
     for (int i = 0; i < n; ++i) {
-        cout << rnd.next(1, 1000);
-        if (i + 1 < n) cout << ' ';
+        fastout << rnd.next(1, 1000);
+        if (i + 1 < n) fastout << ' ';
     }
-    cout << endl;
+    fastout << '\n';
 
     return 0;
 }
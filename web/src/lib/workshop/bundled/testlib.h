@@ -59,10 +59,35 @@
  *     interactor.exe <Input_File> <Output_File> [<Answer_File> [<Result_File> [-appes]]],
  *   Reads test from inf (mapped to args[1]), writes result to tout (mapped to argv[2],
  *   can be judged by checker later), reads program output from ouf (mapped to stdin),
- *   writes output to program via stdout (use cout, printf, etc).
+ *   writes output to program via stdout (use cout, printf, etc). The output is flushed
+ *   automatically each time the interactor waits for the program's answer in ouf.
  */
 
 const char *latestFeatures[] = {
+        "Supported --batchTimeLimit ms in validator --batch mode: a file exceeding it fails alone with \"timeLimitExceeded\"",
+        "PC_BASE_EXIT_CODE=50 by default, so _pc(n) exits with 50 + n and doesn't collide with other verdicts",
+        "Self-profiling with TESTLIB_PROFILE=1: bytes and tokens per stream, refill/parse/user time and peak RSS in a last stderr line",
+        "Added rnd.tree(n, t), rnd.connectedGraph(n, m, t) and rnd.relabel(edges, n) working in O(n + m), fastout.writeEdges(edges)",
+        "Supported --testOverviewLogFileName in validator --batch mode: per-file overviews in the report",
+        "Added testlib::compare<TokenPolicy, CasePolicy, NumberPolicy, TrailingPolicy>(ans, ouf), ready comparison modes selected at compile time",
+        "Added compareDoubles(expected, found, absEps, relEps): rcmp4-style comparison parsing blocks of numbers and checking them with SIMD",
+        "Added skipEqualTokens(first, second, equal) and skipEqualDoubles to skip equal tokens by a predicate, large outputs read from files are compared on several threads",
+        "Message formatting is reentrant and uses no global buffer, verdict messages are capped to 4096 chars, compress() copies only the shown part",
+        "Supported --inputFile fileName for validator, a validator maps stdin (or the input file) when it is a regular file",
+        "Interactors read ouf with read(2) as soon as the answer arrives and flush their output automatically before waiting for it",
+        "Introduced fastout: buffered output with writeRange/setPrecision for generators, println writes through it and does not flush in generators",
+        "Introduced rnd.lazyPerm(size, first): random permutation computed per element without storing it, rnd.distinct uses a preallocated hash set",
+        "Added random generator version 2 (registerGen(argc, argv, 2)): xoshiro256** with rnd.jump() and rnd.split() for parallel generation",
+        "Patterns are compiled into char-class bitsets and a lazy DFA, read-functions cache patterns given by string",
+        "Validator interns variable names (validator.variableId(name)), bounds statistics in read-functions cost no allocations",
+        "Supported --batch listFileName for validator: validates many files in one run, reports a JSON array of per-file results",
+        "Added TESTLIB_THROW_ON_QUIT: quit functions throw verdict_exception, resetTestlib(input, output, answer) prepares the next test in the same process",
+        "Introduced registerTestlibServer(argc, argv) to check many tests in one process, reading file triples from stdin",
+        "Introduced registerTestlibStream(argc, argv) to read the output from stdin (pass \"-\" as <output-file>) while the solution runs",
+        "Introduced readIntsTo/readLongsTo/readDoublesTo to read space-separated numbers into a buffer or a reused vector, readInts/readLongs/readDoubles use them",
+        "Numbers are parsed without allocations (std::from_chars for doubles if available), directly from the reader buffer",
+        "Introduced skipEqualTokens(ans, ouf) to skip equal tokens of two streams with SIMD, used by icpc_diff/wcmp",
+        "Regular files are read through mmap (MmapFileInputStreamReader), use -DTESTLIB_NO_MMAP to disable",
         "Added ConstantBoundsLog, VariablesLog to validator testOverviewLogFile",
         "Use setAppesModeEncoding to change xml encoding from windows-1251 to other",
         "rnd.any/wany use distance/advance instead of -/+: now they support sets/multisets",
@@ -183,16 +208,37 @@ const char *latestFeatures[] = {
 #include <sstream>
 #include <fstream>
 #include <cstring>
+#include <cerrno>
 #include <limits>
 #include <stdarg.h>
 #include <fcntl.h>
 #include <functional>
 #include <cstdint>
+#include <chrono>
 
 #ifdef TESTLIB_THROW_EXIT_EXCEPTION_INSTEAD_OF_EXIT
 #   include <exception>
 #endif
 
+#if __cplusplus >= 201703L && defined(__has_include)
+#   if __has_include(<charconv>)
+#       include <charconv>
+#       if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#           define __TESTLIB_HAS_FROM_CHARS_DOUBLE
+#       endif
+#   endif
+#endif
+
+#if defined(__SSE2__) && !defined(TESTLIB_NO_SIMD)
+#   include <emmintrin.h>
+#   define __TESTLIB_USE_SSE2
+#endif
+
+#if defined(__AVX2__) && !defined(TESTLIB_NO_SIMD)
+#   include <immintrin.h>
+#   define __TESTLIB_USE_AVX2
+#endif
+
 #if (_WIN32 || __WIN32__ || __WIN32 || _WIN64 || __WIN64__ || __WIN64 || WINNT || __WINNT || __WINNT__ || __CYGWIN__)
 #   if !defined(_MSC_VER) || _MSC_VER > 1400
 #       define NOMINMAX 1
@@ -211,6 +257,21 @@ const char *latestFeatures[] = {
 #else
 #   define WORD unsigned short
 #   include <unistd.h>
+#   include <fcntl.h>
+#   include <sys/wait.h>
+#   include <sys/resource.h>
+#   include <poll.h>
+#   include <signal.h>
+#   ifndef TESTLIB_NO_MMAP
+#       include <sys/mman.h>
+#       include <sys/stat.h>
+#       define __TESTLIB_USE_MMAP
+#   endif
+#   ifndef TESTLIB_NO_THREADS
+#       include <thread>
+#       include <atomic>
+#       define __TESTLIB_USE_THREADS
+#   endif
 #endif
 
 #if defined(FOR_WINDOWS) && defined(FOR_LINUX)
@@ -285,12 +346,9 @@ const char *latestFeatures[] = {
 #   define UNEXPECTED_EOF_EXIT_CODE 8
 #endif
 
+/* With base 0 _pc(n) would exit with the codes of other verdicts (_pc(1) as _wa). */
 #ifndef PC_BASE_EXIT_CODE
-#   ifdef TESTSYS
-#       define PC_BASE_EXIT_CODE 50
-#   else
-#       define PC_BASE_EXIT_CODE 0
-#   endif
+#   define PC_BASE_EXIT_CODE 50
 #endif
 
 #ifdef __GNUC__
@@ -315,20 +373,47 @@ const char *latestFeatures[] = {
 #   define NORETURN
 #endif
 
-static char __testlib_format_buffer[16777216];
-static int __testlib_format_buffer_usage_count = 0;
+/*
+ * Formatting is reentrant: every call formats into its own stack buffer, so
+ * format() may be used inside arguments of quitf() and friends.
+ * Verdict messages are capped to __TESTLIB_MAX_FORMATTED_MESSAGE chars and never
+ * touch the heap; other results longer than the stack buffer are formatted
+ * again into a heap buffer of at most __TESTLIB_MAX_FORMATTED_STRING chars.
+ */
+#define __TESTLIB_MAX_FORMATTED_MESSAGE 4096
+#define __TESTLIB_MAX_FORMATTED_STRING 16777215
+
+static std::string __testlib_vformat(size_t maxLength, const char *cstr, va_list ap) {
+    char buffer[__TESTLIB_MAX_FORMATTED_MESSAGE + 1];
+    va_list copy;
+    va_copy(copy, ap);
+    int length = vsnprintf(buffer, sizeof(buffer), cstr, copy);
+    va_end(copy);
+    if (length < 0)
+        return std::string();
+    if (size_t(length) < sizeof(buffer) || maxLength < sizeof(buffer)) {
+        buffer[std::min(maxLength, sizeof(buffer) - 1)] = 0;
+        return std::string(buffer);
+    }
+
+    std::vector<char> heapBuffer(std::min(size_t(length), maxLength) + 1);
+    vsnprintf(&heapBuffer[0], heapBuffer.size(), cstr, ap);
+    return std::string(&heapBuffer[0]);
+}
+
+#define FMT_TO_RESULT_LIMITED(fmt, cstr, result, maxLength) std::string result;        \
+            {                                                                          \
+                va_list ap;                                                            \
+                va_start(ap, fmt);                                                     \
+                result = __testlib_vformat(maxLength, cstr, ap);                       \
+                va_end(ap);                                                            \
+            }
+
+#define FMT_TO_RESULT(fmt, cstr, result)                                               \
+            FMT_TO_RESULT_LIMITED(fmt, cstr, result, __TESTLIB_MAX_FORMATTED_STRING)
 
-#define FMT_TO_RESULT(fmt, cstr, result)  std::string result;                              \
-            if (__testlib_format_buffer_usage_count != 0)                                  \
-                __testlib_fail("FMT_TO_RESULT::__testlib_format_buffer_usage_count != 0"); \
-            __testlib_format_buffer_usage_count++;                                         \
-            va_list ap;                                                                    \
-            va_start(ap, fmt);                                                             \
-            vsnprintf(__testlib_format_buffer, sizeof(__testlib_format_buffer), cstr, ap); \
-            va_end(ap);                                                                    \
-            __testlib_format_buffer[sizeof(__testlib_format_buffer) - 1] = 0;              \
-            result = std::string(__testlib_format_buffer);                                 \
-            __testlib_format_buffer_usage_count--;                                         \
+#define FMT_TO_MESSAGE(fmt, cstr, result)                                              \
+            FMT_TO_RESULT_LIMITED(fmt, cstr, result, __TESTLIB_MAX_FORMATTED_MESSAGE)
 
 #ifdef __GNUC__
 __attribute__ ((format (printf, 1, 2)))
@@ -395,6 +480,15 @@ static inline double __testlib_crop(double value, double a, double b) {
     return value;
 }
 
+#ifdef __GNUC__
+__attribute__((const))
+#endif
+static inline unsigned long long __testlib_mix64(unsigned long long x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
 static bool __testlib_prelimIsNaN(double r) {
     volatile double ra = r;
 #ifndef __BORLANDC__
@@ -711,8 +805,9 @@ FILE* testlib_freopen_(const char* path, const char* mode, FILE* file) {
  *
  * For matching very simple greedy algorithm is used. For example, pattern
  * "[0-9]?1" will not match "1", because of greedy nature of matching.
- * Alternations (meta-symbols "|") are processed with brute-force algorithm, so
- * do not use many alternations in one expression.
+ * On the first match a pattern is compiled into char-class bitsets and a lazily
+ * built DFA, so matching is linear in the length of the string, alternations
+ * (meta-symbols "|") included.
  *
  * If you want to use one expression many times it is better to compile it into
  * a single pattern like "pattern p("[a-z]+")". Later you can use
@@ -727,6 +822,50 @@ FILE* testlib_freopen_(const char* path, const char* mode, FILE* file) {
  */
 class random_t;
 
+/* Node of a compiled pattern: own char-set with counts, children are alternatives of the rest. */
+struct __pattern_node {
+    unsigned long long chars[4];
+    int from;
+    int to;
+    int firstChild;
+    int childCount;
+    bool exitAccepts;
+
+    bool has(unsigned char c) const {
+        return (chars[c >> 6] >> (c & 63)) & 1;
+    }
+};
+
+/*
+ * Compiled pattern. DFA states are sets of (node, chars consumed by the node) and
+ * are built on demand; if there are too many of them, the rest of the string is
+ * matched by simulating the set directly.
+ */
+struct __pattern_program {
+    typedef std::vector<std::pair<int, int> > threads;
+
+    std::vector<__pattern_node> nodes;
+    std::map<threads, int> stateIds;
+    std::vector<threads> states;
+    std::vector<char> accepting;
+    std::vector<int> transitions;
+
+    bool matches(const std::string &s, size_t pos);
+
+private:
+    enum {
+        MAX_STATES = 256,
+        STATE_DEAD = -1,
+        STATE_UNKNOWN = -2,
+        STATE_OVERFLOW = -3
+    };
+
+    void step(int node, int consumed, unsigned char c, threads &result) const;
+    bool accepts(const threads &t) const;
+    int stateId(const threads &t);
+    int transition(int state, unsigned char c);
+};
+
 class pattern {
 public:
     /* Create pattern instance by string. */
@@ -744,11 +883,66 @@ public:
 private:
     bool matches(const std::string &s, size_t pos) const;
 
+    void compileTo(std::vector<__pattern_node> &nodes, size_t index) const;
+
     std::string s;
     std::vector<pattern> children;
     std::vector<char> chars;
     int from;
     int to;
+    mutable __pattern_program program;
+};
+
+/*
+ * Random permutation of [first, first + size) which is not stored: element i is
+ * computed in O(1) expected time by a keyed Feistel network over the range.
+ * Use rnd.lazyPerm(size, first) to get one.
+ */
+template<typename T>
+class lazy_perm {
+public:
+    lazy_perm(long long size, T first, const unsigned long long keys[4]) : _size(size), _first(first), _halfBits(1) {
+        if (size < 0)
+            __testlib_fail("lazy_perm: size must non-negative");
+        while (_halfBits < 32 && (1ULL << (2 * _halfBits)) < (unsigned long long) size)
+            _halfBits++;
+        for (int i = 0; i < 4; i++)
+            _keys[i] = keys[i];
+    }
+
+    long long size() const {
+        return _size;
+    }
+
+    /* Returns element with index i, 0 <= i < size(). */
+    T operator[](long long i) const {
+        if (i < 0 || i >= _size)
+            __testlib_fail("lazy_perm: index " + vtos(i) + " out of range [0, " + vtos(_size) + ")");
+        /* Cycle-walking keeps the Feistel bijection inside [0, size). */
+        unsigned long long x = (unsigned long long) i;
+        do
+            x = permute(x);
+        while (x >= (unsigned long long) _size);
+        return T(_first + T(x));
+    }
+
+private:
+    long long _size;
+    T _first;
+    int _halfBits;
+    unsigned long long _keys[4];
+
+    unsigned long long permute(unsigned long long x) const {
+        unsigned long long mask = (1ULL << _halfBits) - 1;
+        unsigned long long left = x >> _halfBits;
+        unsigned long long right = x & mask;
+        for (int round = 0; round < 4; round++) {
+            unsigned long long next = left ^ (__testlib_mix64(right ^ _keys[round]) & mask);
+            left = right;
+            right = next;
+        }
+        return (left << _halfBits) | right;
+    }
 };
 
 /*
@@ -760,18 +954,61 @@ private:
  * Use registerGen(argc, argv, 1) to setup random_t seed be command
  * line (to use latest random generator version).
  *
+ * registerGen(argc, argv, 2) switches all random_t instances to xoshiro256**:
+ * 64 bits per step and split() for parallel generation. Take one split() per
+ * thread before starting them, the output depends only on the seed and the
+ * number of splits:
+ *
+ *     std::vector<random_t> rs;
+ *     for (int t = 0; t < threads; t++)
+ *         rs.push_back(rnd.split());
+ *
  * Random generates uniformly distributed values if another strategy is
  * not specified explicitly.
  */
 class random_t {
 private:
     unsigned long long seed;
+    unsigned long long state[4];
     static const unsigned long long multiplier;
     static const unsigned long long addend;
     static const unsigned long long mask;
     static const int lim;
 
+    static unsigned long long rotl(unsigned long long x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    /* Seeds xoshiro256** state with splitmix64 as recommended by its authors. */
+    void setState(unsigned long long value) {
+        for (int i = 0; i < 4; i++) {
+            unsigned long long z = (value += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            state[i] = z ^ (z >> 31);
+        }
+    }
+
+    /* xoshiro256** step, used by random generator version 2. */
+    unsigned long long next64() {
+        unsigned long long result = rotl(state[1] * 5, 7) * 9;
+        unsigned long long t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
     long long nextBits(int bits) {
+        if (random_t::version >= 2) {
+            if (bits > 63)
+                __testlib_fail("random_t::nextBits(int bits): n must be less than 64");
+            return (long long) (next64() >> (64 - bits));
+        }
+
         if (bits <= 48) {
             seed = (seed * multiplier + addend) & mask;
             return (long long) (seed >> (48 - bits));
@@ -794,6 +1031,7 @@ public:
     /* New random_t with fixed seed. */
     random_t()
             : seed(3905348978240129619LL) {
+        setState(seed);
     }
 
     /* Sets seed by command line. */
@@ -808,15 +1046,48 @@ public:
             seed += multiplier / addend;
         }
 
+        setState(seed);
         seed = seed & mask;
     }
 
     /* Sets seed by given value. */
     void setSeed(long long _seed) {
         seed = (unsigned long long) _seed;
+        setState(seed);
         seed = (seed ^ multiplier) & mask;
     }
 
+    /* Advances the generator by 2^128 steps (random generator version 2 only). */
+    void jump() {
+        static const unsigned long long JUMP[] = {
+                0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+        };
+
+        if (random_t::version < 2)
+            __testlib_fail("random_t::jump(): use registerGen(argc, argv, 2) to jump the generator");
+
+        unsigned long long result[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 4; i++)
+            for (int b = 0; b < 64; b++) {
+                if (JUMP[i] & (1ULL << b))
+                    for (int j = 0; j < 4; j++)
+                        result[j] ^= state[j];
+                next64();
+            }
+        for (int j = 0; j < 4; j++)
+            state[j] = result[j];
+    }
+
+    /*
+     * Returns a generator for the next 2^128 values of this one and jumps this one past
+     * them (random generator version 2 only). Splits do not overlap.
+     */
+    random_t split() {
+        random_t result(*this);
+        jump();
+        return result;
+    }
+
 #ifndef __BORLANDC__
 
     /* Random string value by given pattern (see pattern documentation). */
@@ -929,6 +1200,8 @@ public:
 
     /* Random double value in range [0, 1). */
     double next() {
+        if (random_t::version >= 2)
+            return (double) (next64() >> 11) / (double) (1LL << 53);
         long long left = ((long long) (nextBits(26)) << 27);
         long long right = nextBits(27);
         return __testlib_crop((double) (left + right) / (double) (1LL << 53), 0.0, 1.0);
@@ -1196,6 +1469,23 @@ public:
         return perm(size, T(0));
     }
 
+    /* Returns random permutation of the given size (values are between `first` and `first`+size-1) without storing it. */
+    template<typename T, typename E>
+    lazy_perm<E> lazyPerm(T size, E first) {
+        if (size < 0)
+            __testlib_fail("random_t::lazyPerm(T size, E first = 0): size must non-negative");
+        unsigned long long keys[4];
+        for (int i = 0; i < 4; i++)
+            keys[i] = (unsigned long long) nextBits(63);
+        return lazy_perm<E>((long long) size, first, keys);
+    }
+
+    /* Returns random permutation of the given size (values are between 0 and size-1) without storing it. */
+    template<typename T>
+    lazy_perm<T> lazyPerm(T size) {
+        return lazyPerm(size, T(0));
+    }
+
     /* Returns `size` unordered (unsorted) distinct numbers between `from` and `to`. */
     template<typename T>
     std::vector<T> distinct(int size, T from, T to) {
@@ -1218,11 +1508,23 @@ public:
             expected += double(n) / double(n - i + 1);
 
         if (expected < double(n)) {
-            std::set<T> vals;
-            while (int(vals.size()) < size) {
+            /* Open addressing set of the taken values, allocated once. */
+            size_t capacity = 2;
+            while (capacity < 2 * size_t(size))
+                capacity <<= 1;
+            std::vector<T> taken(capacity);
+            std::vector<char> used(capacity, 0);
+            result.reserve(size);
+            while (int(result.size()) < size) {
                 T x = T(next(from, to));
-                if (vals.insert(x).second)
+                size_t h = size_t(__testlib_mix64((unsigned long long) x)) & (capacity - 1);
+                while (used[h] && !(taken[h] == x))
+                    h = (h + 1) & (capacity - 1);
+                if (!used[h]) {
+                    used[h] = 1;
+                    taken[h] = x;
                     result.push_back(x);
+                }
             }
         } else {
             if (n > 1000000000)
@@ -1299,6 +1601,121 @@ public:
     std::vector<T> partition(int size, T sum) {
         return partition(size, sum, T(1));
     }
+
+    /*
+     * Returns n - 1 edges of a random tree on vertices 0..n-1: edge i - 1 is (p, i), where
+     * the parent p = wnext(i, t) < i. So t = 0 is a random recursive tree, large t give long
+     * paths (t >= n is almost a path), small t (t <= -n) give stars. Parents precede their
+     * children, use relabel() to hide it:
+     *
+     *     std::vector<std::pair<int, int> > edges = rnd.tree(n, t);
+     *     rnd.relabel(edges, n);
+     *     fastout << n << '\n';
+     *     fastout.writeEdges(edges);
+     */
+    std::vector<std::pair<int, int> > tree(int n, int t = 0) {
+        if (n <= 0)
+            __testlib_fail("random_t::tree(int n, int t): n must be positive");
+        std::vector<std::pair<int, int> > edges;
+        edges.reserve(n - 1);
+        appendTree(edges, n, t);
+        return edges;
+    }
+
+    /*
+     * Returns m edges of a random connected simple graph on vertices 0..n-1 (no loops and
+     * no multiple edges): a tree(n, t) followed by m - n + 1 other distinct edges (u, v), u < v.
+     * Takes O(n + m) expected time. Use relabel() to shuffle the vertices and the edges.
+     */
+    std::vector<std::pair<int, int> > connectedGraph(int n, int m, int t = 0) {
+        if (n <= 0)
+            __testlib_fail("random_t::connectedGraph(int n, int m, int t): n must be positive");
+        long long maxEdges = (long long) n * (n - 1) / 2;
+        if (m < n - 1 || m > maxEdges)
+            __testlib_fail("random_t::connectedGraph(int n, int m, int t): m must be between n - 1 and n * (n - 1) / 2");
+
+        std::vector<std::pair<int, int> > edges;
+        edges.reserve(m);
+        appendTree(edges, n, t);
+        long long need = m - (n - 1);
+        if (need == 0)
+            return edges;
+
+        if (2 * (long long) m > maxEdges) {
+            /* Dense: one pass over all pairs choosing each non-tree pair with probability need/left. */
+            std::vector<int> parent(n, -1);
+            for (size_t i = 0; i < edges.size(); i++)
+                parent[edges[i].second] = edges[i].first;
+            long long left = maxEdges - (n - 1);
+            for (int v = 1; v < n && need > 0; v++)
+                for (int u = 0; u < v && need > 0; u++) {
+                    if (parent[v] == u)
+                        continue;
+                    if (next(left) < need)
+                        edges.push_back(std::make_pair(u, v)), need--;
+                    left--;
+                }
+            return edges;
+        }
+
+        /* Sparse: open addressing set of the taken edges u * n + v, allocated once. */
+        const unsigned long long EMPTY = ~0ULL;
+        size_t capacity = 2;
+        while (capacity < 2 * size_t(m))
+            capacity <<= 1;
+        std::vector<unsigned long long> taken(capacity, EMPTY);
+        for (size_t i = 0; i < edges.size(); i++)
+            insertEdgeKey(taken, (unsigned long long) edges[i].first * n + edges[i].second);
+        while (need > 0) {
+            int u = next(n);
+            int v = next(n);
+            if (u == v)
+                continue;
+            if (u > v)
+                std::swap(u, v);
+            if (insertEdgeKey(taken, (unsigned long long) u * n + v))
+                edges.push_back(std::make_pair(u, v)), need--;
+        }
+        return edges;
+    }
+
+    /*
+     * Renames the vertices 0..n-1 of the edges by a random permutation, swaps the ends of
+     * each edge with probability 1/2 and shuffles the edges, in place. O(n + m).
+     */
+    template<typename T>
+    void relabel(std::vector<std::pair<T, T> > &edges, T n) {
+        std::vector<T> p = perm(n);
+        for (size_t i = 0; i < edges.size(); i++) {
+            if (edges[i].first < 0 || edges[i].first >= n || edges[i].second < 0 || edges[i].second >= n)
+                __testlib_fail("random_t::relabel(edges, n): vertices must be between 0 and n - 1");
+            edges[i].first = p[edges[i].first];
+            edges[i].second = p[edges[i].second];
+            if (next(2))
+                std::swap(edges[i].first, edges[i].second);
+            if (i > 0)
+                std::swap(edges[i], edges[next(int(i + 1))]);
+        }
+    }
+
+private:
+    void appendTree(std::vector<std::pair<int, int> > &edges, int n, int t) {
+        for (int i = 1; i < n; i++)
+            edges.push_back(std::make_pair(wnext(i, t), i));
+    }
+
+    /* Inserts key into the set unless it is there already, returns whether it was inserted. */
+    static bool insertEdgeKey(std::vector<unsigned long long> &taken, unsigned long long key) {
+        size_t mask = taken.size() - 1;
+        size_t h = size_t(__testlib_mix64(key)) & mask;
+        while (taken[h] != ~0ULL) {
+            if (taken[h] == key)
+                return false;
+            h = (h + 1) & mask;
+        }
+        taken[h] = key;
+        return true;
+    }
 };
 
 const int random_t::lim = 25;
@@ -1341,46 +1758,135 @@ static char __pattern_getChar(const std::string &s, size_t &pos) {
     return s[pos - 1];
 }
 
-#ifdef __GNUC__
-__attribute__((pure))
-#endif
-static int __pattern_greedyMatch(const std::string &s, size_t pos, const std::vector<char> chars) {
-    int result = 0;
+std::string pattern::src() const {
+    return s;
+}
 
-    while (pos < s.length()) {
-        char c = s[pos++];
-        if (!std::binary_search(chars.begin(), chars.end(), c))
-            break;
-        else
-            result++;
+void pattern::compileTo(std::vector<__pattern_node> &nodes, size_t index) const {
+    __pattern_node node;
+    std::memset(node.chars, 0, sizeof(node.chars));
+    for (size_t i = 0; i < chars.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(chars[i]);
+        node.chars[c >> 6] |= 1ULL << (c & 63);
     }
+    node.from = from;
+    node.to = to;
+    node.firstChild = int(nodes.size());
+    node.childCount = int(children.size());
+    node.exitAccepts = children.empty();
+    nodes[index] = node;
 
-    return result;
+    nodes.resize(nodes.size() + children.size());
+    for (size_t child = 0; child < children.size(); child++) {
+        size_t childIndex = nodes[index].firstChild + child;
+        children[child].compileTo(nodes, childIndex);
+        if (nodes[childIndex].from == 0 && nodes[childIndex].exitAccepts)
+            nodes[index].exitAccepts = true;
+    }
 }
 
-std::string pattern::src() const {
-    return s;
+bool pattern::matches(const std::string &s, size_t pos) const {
+    if (program.nodes.empty()) {
+        program.nodes.resize(1);
+        compileTo(program.nodes, 0);
+    }
+    return program.matches(s, pos);
 }
 
-bool pattern::matches(const std::string &s, size_t pos) const {
-    std::string result;
+/* Feeds c to the node having consumed chars so far, the node is left greedily. */
+void __pattern_program::step(int node, int consumed, unsigned char c, threads &result) const {
+    const __pattern_node &n = nodes[node];
+    if (consumed < n.to && n.has(c)) {
+        /* With unbounded counts only reaching "from" matters. */
+        if (n.to == INT_MAX && consumed >= n.from)
+            consumed = n.from - 1;
+        result.push_back(std::make_pair(node, consumed + 1));
+        return;
+    }
+    if (consumed < n.from)
+        return;
+    for (int child = n.firstChild; child < n.firstChild + n.childCount; child++)
+        step(child, 0, c, result);
+}
 
-    if (to > 0) {
-        int size = __pattern_greedyMatch(s, pos, chars);
-        if (size < from)
+bool __pattern_program::accepts(const threads &t) const {
+    for (size_t i = 0; i < t.size(); i++)
+        if (t[i].second >= nodes[t[i].first].from && nodes[t[i].first].exitAccepts)
+            return true;
+    return false;
+}
+
+int __pattern_program::stateId(const threads &t) {
+    std::map<threads, int>::iterator i = stateIds.find(t);
+    if (i != stateIds.end())
+        return i->second;
+    if (int(states.size()) >= MAX_STATES)
+        return STATE_OVERFLOW;
+    int id = int(states.size());
+    stateIds[t] = id;
+    states.push_back(t);
+    accepting.push_back(accepts(t));
+    transitions.resize(transitions.size() + 256, STATE_UNKNOWN);
+    return id;
+}
+
+int __pattern_program::transition(int state, unsigned char c) {
+    int result = transitions[state * 256 + c];
+    if (result != STATE_UNKNOWN)
+        return result;
+
+    threads next;
+    for (size_t i = 0; i < states[state].size(); i++)
+        step(states[state][i].first, states[state][i].second, c, next);
+    if (next.empty())
+        result = STATE_DEAD;
+    else {
+        std::sort(next.begin(), next.end());
+        result = stateId(next);
+    }
+    if (result != STATE_OVERFLOW)
+        transitions[state * 256 + c] = result;
+    return result;
+}
+
+bool __pattern_program::matches(const std::string &s, size_t pos) {
+    const __pattern_node &root = nodes[0];
+    if (root.childCount == 0) {
+        size_t length = s.length() - pos;
+        if (length < size_t(root.from) || length > size_t(root.to))
             return false;
-        if (size > to)
-            size = to;
-        pos += size;
+        for (; pos < s.length(); pos++)
+            if (!root.has(static_cast<unsigned char>(s[pos])))
+                return false;
+        return true;
     }
 
-    if (children.size() > 0) {
-        for (size_t child = 0; child < children.size(); child++)
-            if (children[child].matches(s, pos))
-                return true;
-        return false;
-    } else
-        return pos == s.length();
+    if (states.empty())
+        stateId(threads(1, std::make_pair(0, 0)));
+
+    int state = 0;
+    for (; pos < s.length(); pos++) {
+        int next = transition(state, static_cast<unsigned char>(s[pos]));
+        if (next == STATE_DEAD)
+            return false;
+        if (next == STATE_OVERFLOW)
+            break;
+        state = next;
+    }
+    if (pos == s.length())
+        return accepting[state] != 0;
+
+    threads current = states[state];
+    threads next;
+    for (; pos < s.length(); pos++) {
+        next.clear();
+        for (size_t i = 0; i < current.size(); i++)
+            step(current[i].first, current[i].second, static_cast<unsigned char>(s[pos]), next);
+        if (next.empty())
+            return false;
+        current.swap(next);
+    }
+    return accepts(current);
 }
 
 std::string pattern::next(random_t &rnd) const {
@@ -1598,6 +2104,18 @@ pattern::pattern(std::string s) : s(s), from(0), to(0) {
     }
 }
 
+/* Compiled patterns by source for read-functions taking a pattern string. */
+static const pattern &__testlib_pattern(const std::string &ptrn) {
+    static std::map<std::string, pattern> patterns;
+    std::map<std::string, pattern>::iterator i = patterns.find(ptrn);
+    if (i == patterns.end()) {
+        if (patterns.size() >= 1024)
+            patterns.clear();
+        i = patterns.insert(std::make_pair(ptrn, pattern(ptrn))).first;
+    }
+    return i->second;
+}
+
 /* End of pattern implementation */
 
 template<typename C>
@@ -1615,6 +2133,92 @@ inline bool isBlanks(C c) {
     return (c == LF || c == CR || c == SPACE || c == TAB);
 }
 
+#ifdef __TESTLIB_USE_SSE2
+/* Bit i of the result is set iff chunk[i] is a white-space. */
+inline int __testlib_blanksMask(__m128i chunk) {
+    __m128i blanks = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(LF)), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(CR))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(SPACE)), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(TAB))));
+    return _mm_movemask_epi8(blanks);
+}
+#endif
+
+/* Returns the length of the longest prefix of data[0..size) without white-spaces. */
+inline size_t __testlib_tokenLength(const char *data, size_t size) {
+    size_t i = 0;
+#ifdef __TESTLIB_USE_SSE2
+    for (; i + 16 <= size; i += 16) {
+        int mask = __testlib_blanksMask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < size; i++)
+        if (isBlanks(data[i]))
+            return i;
+    return size;
+}
+
+/* Returns the length of the longest common prefix of a[0..size) and b[0..size). */
+inline size_t __testlib_commonPrefix(const char *a, const char *b, size_t size) {
+    size_t i = 0;
+#ifdef __TESTLIB_USE_AVX2
+    for (; i + 32 <= size; i += 32) {
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+        unsigned int mask = ~(unsigned int) _mm256_movemask_epi8(equal);
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+#ifdef __TESTLIB_USE_SSE2
+    for (; i + 16 <= size; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+        int mask = ~_mm_movemask_epi8(equal) & 0xFFFF;
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < size; i++)
+        if (a[i] != b[i])
+            return i;
+    return size;
+}
+
+/* Returns the number of tokens (maximal runs of non-white-spaces) in data[0..size). */
+inline size_t __testlib_countTokens(const char *data, size_t size) {
+    size_t result = 0;
+    size_t i = 0;
+    bool previousBlank = true;
+#ifdef __TESTLIB_USE_SSE2
+    for (; i + 16 <= size; i += 16) {
+        int blanks = __testlib_blanksMask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)));
+        int starts = ~blanks & ((blanks << 1) | (previousBlank ? 1 : 0)) & 0xFFFF;
+        result += __builtin_popcount(starts);
+        previousBlank = (blanks & 0x8000) != 0;
+    }
+#endif
+    for (; i < size; i++) {
+        bool blank = isBlanks(data[i]);
+        if (previousBlank && !blank)
+            result++;
+        previousBlank = blank;
+    }
+    return result;
+}
+
+/* Returns the number of line feeds in data[0..size). */
+inline int __testlib_countLines(const char *data, size_t size) {
+    int result = 0;
+    const char *end = data + size;
+    while (data < end && NULL != (data = static_cast<const char *>(std::memchr(data, LF, end - data)))) {
+        result++;
+        data++;
+    }
+    return result;
+}
+
 inline std::string trim(const std::string &s) {
     if (s.empty())
         return s;
@@ -1681,6 +2285,88 @@ const std::string outcomes[] = {
         "partially-correct"
 };
 
+/*
+ * Self-profiling, enabled by the environment variable TESTLIB_PROFILE=1. The process then
+ * ends its stderr with one line (after the verdict message)
+ *     testlib-profile: {"inf": {"bytes": 12, "tokens": 3}, "ouf": {...}, "ans": {...},
+ *         "refillMs": 0.1, "parseMs": 0.2, "userMs": 0.3, "peakRssKb": 3456}
+ * bytes are taken from the file of the stream, tokens count the values returned by
+ * read-functions (tokens, numbers, lines and chars) and the tokens skipped by skipEqualTokens.
+ * refillMs is spent reading files into the buffer, parseMs in read-functions besides that,
+ * userMs is the rest of the time since the start (checker logic, output, and comparing
+ * through spans as skipEqualTokens does).
+ */
+struct __testlib_profile_t {
+    bool enabled;
+    int depth;
+    unsigned long long bytes[3];
+    unsigned long long tokens[3];
+    double start;
+    double readSeconds;
+    double refillSeconds;
+    double refillInReadSeconds;
+
+    __testlib_profile_t() : depth(0), start(now()), readSeconds(0), refillSeconds(0), refillInReadSeconds(0) {
+        const char *value = std::getenv("TESTLIB_PROFILE");
+        enabled = NULL != value && *value != 0 && std::strcmp(value, "0") != 0;
+        for (int i = 0; i < 3; i++)
+            bytes[i] = tokens[i] = 0;
+    }
+
+    static double now() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+__testlib_profile_t __testlib_profile;
+
+/* Times an outermost read-function call on the stream of the given mode and counts its tokens. */
+struct __testlib_read_scope {
+    double begin;
+    bool outermost;
+
+    explicit __testlib_read_scope(TMode mode, unsigned long long tokens = 1) : begin(0), outermost(false) {
+        if (__testlib_profile.enabled && __testlib_profile.depth++ == 0) {
+            outermost = true;
+            __testlib_profile.tokens[mode] += tokens;
+            begin = __testlib_profile_t::now();
+        }
+    }
+
+    ~__testlib_read_scope() {
+        if (__testlib_profile.enabled) {
+            __testlib_profile.depth--;
+            if (outermost)
+                __testlib_profile.readSeconds += __testlib_profile_t::now() - begin;
+        }
+    }
+};
+
+/* Counts tokens which were compared over spans without read-functions. */
+inline void __testlib_profileSkippedTokens(TMode first, TMode second, unsigned long long count) {
+    if (__testlib_profile.enabled) {
+        __testlib_profile.tokens[first] += count;
+        __testlib_profile.tokens[second] += count;
+    }
+}
+
+/* Times a refill of a reader buffer. */
+struct __testlib_refill_scope {
+    double begin;
+
+    __testlib_refill_scope() : begin(__testlib_profile.enabled ? __testlib_profile_t::now() : 0) {
+    }
+
+    ~__testlib_refill_scope() {
+        if (__testlib_profile.enabled) {
+            double seconds = __testlib_profile_t::now() - begin;
+            __testlib_profile.refillSeconds += seconds;
+            if (__testlib_profile.depth > 0)
+                __testlib_profile.refillInReadSeconds += seconds;
+        }
+    }
+};
+
 class InputStreamReader {
 public:
     virtual void setTestCase(int testCase) = 0;
@@ -1703,6 +2389,36 @@ public:
 
     virtual int getLine() = 0;
 
+    /*
+     * Gives direct access to the buffered characters from the current position:
+     * sets data/size to them (refilling the buffer if it is exhausted, size is 0 at EOF)
+     * and returns true; atEof is set if the stream ends right after them.
+     * Readers without an internal buffer return false and are read char by char.
+     */
+    virtual bool getSpan(const char *&, size_t &, bool &) {
+        return false;
+    }
+
+    /* Moves the position forward by n characters of the span returned by getSpan(). */
+    virtual void skipSpan(size_t n) {
+        for (size_t i = 0; i < n; i++)
+            skipChar();
+    }
+
+    /*
+     * Appends the next part of the stream to the span returned by getSpan(), keeping the rest of it
+     * (as a token cut by the end of the buffer). Returns false if nothing can be appended: the stream
+     * has ended, the rest is too long to keep or the reader has no such buffer.
+     */
+    virtual bool extendSpan() {
+        return false;
+    }
+
+    /* Number of bytes taken from the source so far (for TESTLIB_PROFILE). */
+    virtual unsigned long long bytesRead() {
+        return 0;
+    }
+
     virtual ~InputStreamReader() = 0;
 };
 
@@ -1755,6 +2471,21 @@ public:
             s[pos] = char(c);
     }
 
+    bool getSpan(const char *&data, size_t &size, bool &atEof) {
+        data = s.data() + __testlib_min(pos, s.length());
+        size = pos < s.length() ? s.length() - pos : 0;
+        atEof = true;
+        return true;
+    }
+
+    void skipSpan(size_t n) {
+        pos += n;
+    }
+
+    unsigned long long bytesRead() {
+        return __testlib_min(pos, s.length());
+    }
+
     std::string getName() {
         return __testlib_part(s);
     }
@@ -1780,6 +2511,7 @@ private:
     std::vector<int> undoChars;
     std::vector<int> readChars;
     std::vector<int> undoReadChars;
+    unsigned long long taken;
 
     inline int postprocessGetc(int getcResult) {
         if (getcResult != EOF)
@@ -1794,6 +2526,8 @@ private:
 
         if (undoChars.empty()) {
             c = rc = ::getc(file);
+            if (c != EOF)
+                taken++;
         } else {
             c = undoChars.back();
             undoChars.pop_back();
@@ -1820,7 +2554,7 @@ private:
     }
 
 public:
-    FileInputStreamReader(std::FILE *file, const std::string &name) : file(file), name(name), line(1) {
+    FileInputStreamReader(std::FILE *file, const std::string &name) : file(file), name(name), line(1), taken(0) {
         // No operations.
     }
 
@@ -1859,6 +2593,10 @@ public:
         ungetc(c/*, file*/);
     }
 
+    unsigned long long bytesRead() {
+        return taken;
+    }
+
     std::string getName() {
         return name;
     }
@@ -1887,6 +2625,15 @@ public:
     }
 };
 
+/* Called before an interactor waits for the participant: flushes everything written to it. */
+static void (*__testlib_beforeInteractiveRead)() = NULL;
+
+/*
+ * Reader over a stream (usually a pipe) with a manual buffer. The end of the
+ * buffered data is tracked by bufferSize only, so reading a character costs one
+ * compare and one load. The first MAX_UNREAD_COUNT bytes of the buffer are kept
+ * free for unreadChar() after a refill.
+ */
 class BufferedFileInputStreamReader : public InputStreamReader {
 private:
     static const size_t BUFFER_SIZE;
@@ -1897,33 +2644,66 @@ private:
     int line;
 
     char *buffer;
-    bool *isEof;
-    int bufferPos;
+    size_t bufferPos;
     size_t bufferSize;
+    bool eofReached;
+    bool partialReads;
+    unsigned long long totalRead;
 
-    bool refill() {
+    /* Reads the next part of the file to buffer + MAX_UNREAD_COUNT, returns its size. */
+    size_t readBlock() {
         if (NULL == file)
             __testlib_fail("BufferedFileInputStreamReader: file == NULL (" + getName() + ")");
 
-        if (bufferPos >= int(bufferSize)) {
-            size_t readSize = fread(
+        __testlib_refill_scope scope;
+        size_t readSize;
+#ifndef ON_WINDOWS
+        if (partialReads) {
+            /* Take whatever the writer has produced so far instead of waiting for a full buffer. */
+            if (NULL != __testlib_beforeInteractiveRead)
+                __testlib_beforeInteractiveRead();
+            ssize_t result;
+            do {
+                result = read(fileno(file), buffer + MAX_UNREAD_COUNT, BUFFER_SIZE - MAX_UNREAD_COUNT);
+            } while (result < 0 && errno == EINTR);
+            if (result < 0)
+                __testlib_fail("BufferedFileInputStreamReader: unable to read (" + getName() + ")");
+            readSize = size_t(result);
+            if (readSize == 0)
+                eofReached = true;
+        } else
+#endif
+        {
+            readSize = fread(
                     buffer + MAX_UNREAD_COUNT,
                     1,
                     BUFFER_SIZE - MAX_UNREAD_COUNT,
                     file
             );
 
-            if (readSize < BUFFER_SIZE - MAX_UNREAD_COUNT
-                && ferror(file))
-                __testlib_fail("BufferedFileInputStreamReader: unable to read (" + getName() + ")");
+            if (readSize < BUFFER_SIZE - MAX_UNREAD_COUNT) {
+                if (ferror(file))
+                    __testlib_fail("BufferedFileInputStreamReader: unable to read (" + getName() + ")");
+                eofReached = true;
+            }
+        }
 
-            bufferSize = MAX_UNREAD_COUNT + readSize;
-            bufferPos = int(MAX_UNREAD_COUNT);
-            std::memset(isEof + MAX_UNREAD_COUNT, 0, sizeof(isEof[0]) * readSize);
+        totalRead += readSize;
+        return readSize;
+    }
 
-            return readSize > 0;
-        } else
+    bool refill() {
+        if (bufferPos < bufferSize)
             return true;
+
+        if (eofReached)
+            return false;
+
+        size_t readSize = readBlock();
+        bufferSize = MAX_UNREAD_COUNT + readSize;
+        bufferPos = MAX_UNREAD_COUNT;
+
+        return readSize > 0;
     }
 
     char increment() {
@@ -1934,11 +2714,18 @@ private:
     }
 
 public:
-    BufferedFileInputStreamReader(std::FILE *file, const std::string &name) : file(file), name(name), line(1) {
+    /*
+     * With partialReads the reader returns as soon as any data are available (pipes),
+     * an empty read(2) is the end of file.
+     */
+    BufferedFileInputStreamReader(std::FILE *file, const std::string &name, bool partialReads = false)
+            : file(file), name(name), line(1) {
         buffer = new char[BUFFER_SIZE];
-        isEof = new bool[BUFFER_SIZE];
         bufferSize = MAX_UNREAD_COUNT;
-        bufferPos = int(MAX_UNREAD_COUNT);
+        bufferPos = MAX_UNREAD_COUNT;
+        eofReached = false;
+        this->partialReads = partialReads;
+        totalRead = 0;
     }
 
     ~BufferedFileInputStreamReader() {
@@ -1946,10 +2733,6 @@ public:
             delete[] buffer;
             buffer = NULL;
         }
-        if (NULL != isEof) {
-            delete[] isEof;
-            isEof = NULL;
-        }
     }
 
     void setTestCase(int) {
@@ -1961,33 +2744,74 @@ public:
     }
     
     int curChar() {
-        if (!refill())
+        if (bufferPos >= bufferSize && !refill())
             return EOFC;
 
-        return isEof[bufferPos] ? EOFC : buffer[bufferPos];
+        return buffer[bufferPos];
     }
 
     int nextChar() {
-        if (!refill())
+        if (bufferPos >= bufferSize && !refill())
             return EOFC;
 
-        return isEof[bufferPos] ? EOFC : increment();
+        return increment();
     }
 
     void skipChar() {
+        if (bufferPos >= bufferSize && !refill())
+            return;
+
         increment();
     }
 
     void unreadChar(int c) {
-        bufferPos--;
-        if (bufferPos < 0)
-            __testlib_fail("BufferedFileInputStreamReader::unreadChar(int): bufferPos < 0");
-        isEof[bufferPos] = (c == EOFC);
+        // Reading at EOF doesn't move the position, so there is nothing to put back.
+        if (c == EOFC)
+            return;
+        if (bufferPos == 0)
+            __testlib_fail("BufferedFileInputStreamReader::unreadChar(int): bufferPos < 0");
+        bufferPos--;
         buffer[bufferPos] = char(c);
         if (c == LF)
             line--;
     }
 
+    bool getSpan(const char *&data, size_t &size, bool &atEof) {
+        if (bufferPos >= bufferSize && !refill()) {
+            data = buffer + bufferPos;
+            size = 0;
+            atEof = true;
+            return true;
+        }
+
+        data = buffer + bufferPos;
+        size = bufferSize - bufferPos;
+        atEof = eofReached;
+        return true;
+    }
+
+    void skipSpan(size_t n) {
+        line += __testlib_countLines(buffer + bufferPos, n);
+        bufferPos += n;
+    }
+
+    bool extendSpan() {
+        size_t rest = bufferSize - bufferPos;
+        if (eofReached || rest > MAX_UNREAD_COUNT / 2)
+            return false;
+
+        // The rest goes right before the read part, the space before it is still left for unreadChar().
+        std::memmove(buffer + MAX_UNREAD_COUNT - rest, buffer + bufferPos, rest);
+        size_t readSize = readBlock();
+        bufferPos = MAX_UNREAD_COUNT - rest;
+        bufferSize = MAX_UNREAD_COUNT + readSize;
+        return true;
+    }
+
+    unsigned long long bytesRead() {
+        return totalRead;
+    }
+
     std::string getName() {
         return name;
     }
@@ -1997,7 +2821,7 @@ public:
     }
 
     bool eof() {
-        return !refill() || EOFC == curChar();
+        return bufferPos >= bufferSize && !refill();
     }
 
     void close() {
@@ -2011,6 +2835,155 @@ public:
 const size_t BufferedFileInputStreamReader::BUFFER_SIZE = 2000000;
 const size_t BufferedFileInputStreamReader::MAX_UNREAD_COUNT = BufferedFileInputStreamReader::BUFFER_SIZE / 2;
 
+#ifdef __TESTLIB_USE_MMAP
+/*
+ * Reader over a regular file mapped into memory: characters are taken straight
+ * from the page cache, there is no copying into an intermediate buffer.
+ * The mapping is private and writable, so unreadChar() can put characters back
+ * (copy-on-write, the file itself is never modified).
+ * Compile with -DTESTLIB_NO_MMAP to always use BufferedFileInputStreamReader.
+ */
+class MmapFileInputStreamReader : public InputStreamReader {
+private:
+    std::FILE *file;
+    std::string name;
+    int line;
+
+    char *data;
+    size_t size;
+    size_t pos;
+    std::vector<std::pair<size_t, int> > testCaseMarks;
+
+public:
+    /*
+     * Maps the whole file into memory. Returns NULL if the file can't be mapped
+     * (not a regular file, empty file, mmap failure): use another reader in this case.
+     */
+    static char *map(std::FILE *file, size_t &size) {
+        struct stat st;
+        if (NULL == file || fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0
+                || (unsigned long long) st.st_size > (unsigned long long) (std::numeric_limits<size_t>::max)())
+            return NULL;
+
+        size = size_t(st.st_size);
+        void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+        if (MAP_FAILED == mapped)
+            return NULL;
+#ifdef MADV_SEQUENTIAL
+        madvise(mapped, size, MADV_SEQUENTIAL);
+#endif
+        return static_cast<char *>(mapped);
+    }
+
+    MmapFileInputStreamReader(std::FILE *file, const std::string &name, char *data, size_t size)
+            : file(file), name(name), line(1), data(data), size(size), pos(0) {
+        // No operations.
+    }
+
+    ~MmapFileInputStreamReader() {
+        close();
+    }
+
+    void setTestCase(int testCase) {
+        if (testCase < 0 || testCase > __TESTLIB_MAX_TEST_CASE)
+            __testlib_fail(testlib_format_("testCase expected fit in [1,%d], but %d doesn't", __TESTLIB_MAX_TEST_CASE, testCase));
+        testCaseMarks.push_back(std::make_pair(pos, testCase + 256));
+    }
+
+    /* The characters read so far are the mapped prefix, test case marks are put at their positions. */
+    std::vector<int> getReadChars() {
+        size_t readCount = __testlib_min(pos, size);
+        std::vector<int> result;
+        result.reserve(readCount + testCaseMarks.size() + 1);
+        size_t mark = 0;
+        for (size_t i = 0; i < readCount; i++) {
+            while (mark < testCaseMarks.size() && testCaseMarks[mark].first <= i)
+                result.push_back(testCaseMarks[mark++].second);
+            result.push_back((unsigned char) data[i]);
+        }
+        while (mark < testCaseMarks.size() && testCaseMarks[mark].first <= size)
+            result.push_back(testCaseMarks[mark++].second);
+        if (pos > size)
+            result.push_back(EOF);
+        while (mark < testCaseMarks.size())
+            result.push_back(testCaseMarks[mark++].second);
+        return result;
+    }
+
+    int curChar() {
+        return pos < size ? data[pos] : EOFC;
+    }
+
+    int nextChar() {
+        if (pos >= size) {
+            pos++;
+            return EOFC;
+        }
+        char c = data[pos++];
+        if (c == LF)
+            line++;
+        return c;
+    }
+
+    void skipChar() {
+        if (pos < size && data[pos] == LF)
+            line++;
+        pos++;
+    }
+
+    void unreadChar(int c) {
+        if (pos == 0)
+            __testlib_fail("MmapFileInputStreamReader::unreadChar(int): pos == 0.");
+        pos--;
+        // Don't touch the page if the character is unchanged (the usual case): no copy-on-write.
+        if (pos < size && data[pos] != char(c))
+            data[pos] = char(c);
+        if (c == LF)
+            line--;
+    }
+
+    bool getSpan(const char *&span, size_t &spanSize, bool &atEof) {
+        span = data + __testlib_min(pos, size);
+        spanSize = pos < size ? size - pos : 0;
+        atEof = true;
+        return true;
+    }
+
+    void skipSpan(size_t n) {
+        line += __testlib_countLines(data + pos, n);
+        pos += n;
+    }
+
+    unsigned long long bytesRead() {
+        return __testlib_min(pos, size);
+    }
+
+    std::string getName() {
+        return name;
+    }
+
+    int getLine() {
+        return line;
+    }
+
+    bool eof() {
+        return pos >= size;
+    }
+
+    void close() {
+        if (NULL != data) {
+            munmap(data, size);
+            data = NULL;
+            size = 0;
+        }
+        if (NULL != file) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+};
+#endif
+
 /*
  * Streams to be used for reading data in checkers or validators.
  * Each read*() method moves pointer to the next character after the
@@ -2234,6 +3207,42 @@ struct InStream {
 
     std::vector<double> readDoubles(int size, int indexBase = 1);
 
+    /*
+     * Batch versions of readInts/readLongs/readDoubles: read a space-separated sequence
+     * into a caller-provided buffer or into a reused vector (resized to size).
+     * Numbers are parsed in one loop without per-element allocations, range checks and
+     * validator bookkeeping are done per block. Checks and messages are as in readInts etc.
+     */
+    void readIntsTo(int *result, int size, int minv, int maxv, const std::string &variablesName = "",
+                    int indexBase = 1);
+
+    void readIntsTo(int *result, int size, int indexBase = 1);
+
+    void readIntsTo(std::vector<int> &result, int size, int minv, int maxv, const std::string &variablesName = "",
+                    int indexBase = 1);
+
+    void readIntsTo(std::vector<int> &result, int size, int indexBase = 1);
+
+    void readLongsTo(long long *result, int size, long long minv, long long maxv,
+                     const std::string &variablesName = "", int indexBase = 1);
+
+    void readLongsTo(long long *result, int size, int indexBase = 1);
+
+    void readLongsTo(std::vector<long long> &result, int size, long long minv, long long maxv,
+                     const std::string &variablesName = "", int indexBase = 1);
+
+    void readLongsTo(std::vector<long long> &result, int size, int indexBase = 1);
+
+    void readDoublesTo(double *result, int size, double minv, double maxv, const std::string &variablesName = "",
+                       int indexBase = 1);
+
+    void readDoublesTo(double *result, int size, int indexBase = 1);
+
+    void readDoublesTo(std::vector<double> &result, int size, double minv, double maxv,
+                       const std::string &variablesName = "", int indexBase = 1);
+
+    void readDoublesTo(std::vector<double> &result, int size, int indexBase = 1);
+
     /*
      * As "readReal()" but ensures that value in the range [minv,maxv] and
      * number of digit after the decimal point is in range [minAfterPointDigitCount,maxAfterPointDigitCount]
@@ -2383,10 +3392,23 @@ struct InStream {
     /* Skips UTF-8 Byte Order Mark. */
     void skipBom();
 
+    /*
+     * Reads a token like readWordTo(), but doesn't copy it if possible: returns a pointer
+     * into the reader buffer (or into an internal string) which is valid until the next
+     * read. Sets length to the token length, the token isn't null-terminated.
+     */
+    const char *readTokenView(size_t &length);
+
 private:
     InStream(const InStream &);
 
     InStream &operator=(const InStream &);
+
+    void checkManySize(int size, const char *functionName);
+
+    template<typename T>
+    void readManyTo(T *result, int size, T minv, T maxv, bool checkRange,
+                    const std::string &variablesName, int indexBase);
 };
 
 InStream inf;
@@ -2401,6 +3423,7 @@ TTestlibMode testlibMode = _unknown;
 double __testlib_points = std::numeric_limits<float>::infinity();
 
 const size_t VALIDATOR_MAX_VARIABLE_COUNT = 255;
+const size_t VALIDATOR_MAX_VARIABLE_HANDLE_COUNT = 65536;
 
 struct ValidatorBoundsHit {
     static const double EPS;
@@ -2465,11 +3488,38 @@ private:
     int _testCase = -1;
     std::string _testCaseFileName;
 
-    std::map<std::string, ValidatorBoundsHit> _boundsHitByVariableName;
-    std::map<std::string, ConstantBounds> _constantBoundsByVariableName;
+    /* Statistics of a variable name after prepVariableName(), i.e. "~a", "a~" and "a" share it. */
+    struct VariableStats {
+        bool hasBoundsHit;
+        ValidatorBoundsHit boundsHit;
+        bool hasConstantBounds;
+        ConstantBounds constantBounds;
+        bool isVariable;
+
+        VariableStats() : hasBoundsHit(false), boundsHit(), hasConstantBounds(false), constantBounds(),
+                          isVariable(false) {
+        }
+    };
+
+    /* Interned variable name as passed to read-functions: its stats slot and '~' modifiers. */
+    struct VariableHandle {
+        int stats;
+        bool ignoreMinBound;
+        bool ignoreMaxBound;
+    };
+
+    std::map<std::string, int> _statsByVariableName;
+    std::vector<VariableStats> _variableStats;
+    std::map<std::string, int> _handleByVariableName;
+    std::vector<VariableHandle> _variableHandles;
+    bool _hasLastVariableName;
+    std::string _lastVariableName;
+    int _lastVariableId;
+    size_t _boundsHitCount;
+    size_t _constantBoundsCount;
+    size_t _variableCount;
     std::set<std::string> _features;
     std::set<std::string> _hitFeatures;
-    std::set<std::string> _variables;
 
     bool isVariableNameBoundsAnalyzable(const std::string &variableName) {
         for (size_t i = 0; i < variableName.length(); i++)
@@ -2486,7 +3536,8 @@ private:
     }
 
 public:
-    Validator() : _initialized(false), _testset("tests"), _group() {
+    Validator() : _initialized(false), _testset("tests"), _group(), _hasLastVariableName(false), _lastVariableName(),
+                  _lastVariableId(-1), _boundsHitCount(0), _constantBoundsCount(0), _variableCount(0) {
     }
 
     void initialize() {
@@ -2565,49 +3616,104 @@ public:
         return variableName.length() >= 2 && variableName != "~~" && variableName.back() == '~';
     }
 
-    void addBoundsHit(const std::string &variableName, ValidatorBoundsHit boundsHit) {
-        if (isVariableNameBoundsAnalyzable(variableName)
-                && _boundsHitByVariableName.size() < VALIDATOR_MAX_VARIABLE_COUNT) {
+    /*
+     * Interns a variable name and returns its handle for addBoundsHit/adjustConstantBounds/addVariable,
+     * or -1 if the name is not tracked (e.g. contains digits). The last name is cached, so calling it
+     * with the same name in a loop costs a single string comparison.
+     */
+    int variableId(const std::string &variableName) {
+        if (_hasLastVariableName && variableName == _lastVariableName)
+            return _lastVariableId;
+
+        int id = -1;
+        std::map<std::string, int>::iterator handle = _handleByVariableName.find(variableName);
+        if (handle != _handleByVariableName.end())
+            id = handle->second;
+        else if (isVariableNameBoundsAnalyzable(variableName)
+                && _variableHandles.size() < VALIDATOR_MAX_VARIABLE_HANDLE_COUNT) {
             std::string preparedVariableName = prepVariableName(variableName);
-            _boundsHitByVariableName[preparedVariableName] = boundsHit.merge(_boundsHitByVariableName[preparedVariableName],
-                ignoreMinBound(variableName), ignoreMaxBound(variableName));
+            std::map<std::string, int>::iterator stats = _statsByVariableName.find(preparedVariableName);
+            if (stats == _statsByVariableName.end()) {
+                stats = _statsByVariableName.insert(std::make_pair(preparedVariableName,
+                        int(_variableStats.size()))).first;
+                _variableStats.push_back(VariableStats());
+            }
+            VariableHandle variableHandle = {stats->second, ignoreMinBound(variableName), ignoreMaxBound(variableName)};
+            id = int(_variableHandles.size());
+            _variableHandles.push_back(variableHandle);
+            _handleByVariableName[variableName] = id;
         }
+
+        _hasLastVariableName = true;
+        _lastVariableName = variableName;
+        _lastVariableId = id;
+        return id;
+    }
+
+    void addBoundsHit(int variableId, ValidatorBoundsHit boundsHit) {
+        if (variableId < 0 || _boundsHitCount >= VALIDATOR_MAX_VARIABLE_COUNT)
+            return;
+        const VariableHandle &handle = _variableHandles[variableId];
+        VariableStats &stats = _variableStats[handle.stats];
+        if (!stats.hasBoundsHit)
+            stats.hasBoundsHit = true, _boundsHitCount++;
+        stats.boundsHit = boundsHit.merge(stats.boundsHit, handle.ignoreMinBound, handle.ignoreMaxBound);
+    }
+
+    void addBoundsHit(const std::string &variableName, ValidatorBoundsHit boundsHit) {
+        addBoundsHit(variableId(variableName), boundsHit);
+    }
+
+    void addVariable(int variableId) {
+        if (variableId < 0 || _variableCount >= VALIDATOR_MAX_VARIABLE_COUNT)
+            return;
+        VariableStats &stats = _variableStats[_variableHandles[variableId].stats];
+        if (!stats.isVariable)
+            stats.isVariable = true, _variableCount++;
     }
 
     void addVariable(const std::string &variableName) {
-        if (isVariableNameBoundsAnalyzable(variableName)
-                && _variables.size() < VALIDATOR_MAX_VARIABLE_COUNT) {
-            std::string preparedVariableName = prepVariableName(variableName);
-            _variables.insert(preparedVariableName);
-        }
+        addVariable(variableId(variableName));
     }
 
     std::string getVariablesLog() {
         std::string result;
-        for (const std::string &variableName: _variables)
-            result += "variable \"" + variableName + "\"\n";
+        for (std::map<std::string, int>::iterator i = _statsByVariableName.begin();
+             i != _statsByVariableName.end();
+             i++)
+            if (_variableStats[i->second].isVariable)
+                result += "variable \"" + i->first + "\"\n";
         return result;
     }
 
+    template<typename T>
+    void adjustConstantBounds(int variableId, T lower, T upper) {
+        if (variableId < 0 || _constantBoundsCount >= VALIDATOR_MAX_VARIABLE_COUNT)
+            return;
+        VariableStats &stats = _variableStats[_variableHandles[variableId].stats];
+        if (!stats.hasConstantBounds)
+            stats.hasConstantBounds = true, _constantBoundsCount++;
+        stats.constantBounds.lowerBound.adjust(lower);
+        stats.constantBounds.upperBound.adjust(upper);
+    }
+
     template<typename T>
     void adjustConstantBounds(const std::string &variableName, T lower, T upper) {
-        if (isVariableNameBoundsAnalyzable(variableName)
-                && _constantBoundsByVariableName.size() < VALIDATOR_MAX_VARIABLE_COUNT) {
-            std::string preparedVariableName = prepVariableName(variableName);
-            _constantBoundsByVariableName[preparedVariableName].lowerBound.adjust(lower);
-            _constantBoundsByVariableName[preparedVariableName].upperBound.adjust(upper);
-        }
+        adjustConstantBounds(variableId(variableName), lower, upper);
     }
 
     std::string getBoundsHitLog() {
         std::string result;
-        for (std::map<std::string, ValidatorBoundsHit>::iterator i = _boundsHitByVariableName.begin();
-             i != _boundsHitByVariableName.end();
+        for (std::map<std::string, int>::iterator i = _statsByVariableName.begin();
+             i != _statsByVariableName.end();
              i++) {
+            const VariableStats &stats = _variableStats[i->second];
+            if (!stats.hasBoundsHit)
+                continue;
             result += "\"" + i->first + "\":";
-            if (i->second.minHit)
+            if (stats.boundsHit.minHit)
                 result += " min-value-hit";
-            if (i->second.maxHit)
+            if (stats.boundsHit.maxHit)
                 result += " max-value-hit";
             result += "\n";
         }
@@ -2616,17 +3722,20 @@ public:
 
     std::string getConstantBoundsLog() {
         std::string result;
-        for (std::map<std::string, ConstantBounds>::iterator i = _constantBoundsByVariableName.begin();
-             i != _constantBoundsByVariableName.end();
+        for (std::map<std::string, int>::iterator i = _statsByVariableName.begin();
+             i != _statsByVariableName.end();
              i++) {
-            if (i->second.lowerBound.has_value() || i->second.upperBound.has_value()) {
+            ConstantBounds &bounds = _variableStats[i->second].constantBounds;
+            if (!_variableStats[i->second].hasConstantBounds)
+                continue;
+            if (bounds.lowerBound.has_value() || bounds.upperBound.has_value()) {
                 result += "constant-bounds \"" + i->first + "\":";
-                if (i->second.lowerBound.has_value())
-                    result += " " + i->second.lowerBound.value;
+                if (bounds.lowerBound.has_value())
+                    result += " " + bounds.lowerBound.value;
                 else
                     result += " ?";
-                if (i->second.upperBound.has_value())
-                    result += " " + i->second.upperBound.value;
+                if (bounds.upperBound.has_value())
+                    result += " " + bounds.upperBound.value;
                 else
                     result += " ?";
                 result += "\n";
@@ -2788,6 +3897,8 @@ const std::string Validator::TEST_MARKUP_HEADER = "MU\xF3\x01";
 const std::string Validator::TEST_CASE_OPEN_TAG = "!c";
 const std::string Validator::TEST_CASE_CLOSE_TAG = ";";
 
+void __testlib_writeProfile();
+
 struct TestlibFinalizeGuard {
     static bool alive;
     static bool registered;
@@ -2821,6 +3932,9 @@ struct TestlibFinalizeGuard {
             validator.writeTestMarkup();
             validator.writeTestCase();
         }
+
+        if (__testlib_profile.enabled)
+            __testlib_writeProfile();
     }
 
 private:
@@ -2987,6 +4101,30 @@ public:
 };
 #endif
 
+#ifdef TESTLIB_THROW_ON_QUIT
+/*
+ * Thrown by quit/quitf/quitp (and everything built on them) instead of terminating the process,
+ * so one process can run a checker many times. Catch it and call resetTestlib(...) before the next test.
+ */
+class verdict_exception: public std::exception {
+private:
+    TResult result;
+    std::string message;
+    double points;
+    int exitCode;
+public:
+    verdict_exception(TResult result, const std::string &message, double points, int exitCode)
+            : result(result), message(message), points(points), exitCode(exitCode) {}
+    ~verdict_exception() throw() {}
+    TResult getResult() const { return result; }
+    const std::string &getMessage() const { return message; }
+    /* Points passed to quitp, infinity if there were none. */
+    double getPoints() const { return points; }
+    int getExitCode() const { return exitCode; }
+    const char *what() const throw() { return message.c_str(); }
+};
+#endif
+
 NORETURN void halt(int exitCode) {
 #ifdef FOOTER
     InStream::textColor(InStream::LightGray);
@@ -3155,6 +4293,19 @@ NORETURN void InStream::quit(TResult result, const char *msg) {
                 quit(_fail, "What is the code ??? ");
     }
 
+#ifdef TESTLIB_THROW_ON_QUIT
+    /* Nothing can catch an exception thrown from TestlibFinalizeGuard, so it quits as usual. */
+    if (TestlibFinalizeGuard::alive) {
+        inf.close();
+        ouf.close();
+        ans.close();
+        if (tout.is_open())
+            tout.close();
+        throw verdict_exception(result, __testlib_toPrintableMessage(message), __testlib_points,
+                                resultExitCode(result));
+    }
+#endif
+
     if (resultName != "") {
         resultFile = testlib_fopen_(resultName.c_str(), "w");
         if (resultFile == NULL) {
@@ -3208,7 +4359,7 @@ NORETURN void InStream::quit(TResult result, const char *msg) {
 __attribute__ ((format (printf, 3, 4)))
 #endif
 NORETURN void InStream::quitf(TResult result, const char *msg, ...) {
-    FMT_TO_RESULT(msg, msg, message);
+    FMT_TO_MESSAGE(msg, msg, message);
     InStream::quit(result, message.c_str());
 }
 
@@ -3217,7 +4368,7 @@ __attribute__ ((format (printf, 4, 5)))
 #endif
 void InStream::quitif(bool condition, TResult result, const char *msg, ...) {
     if (condition) {
-        FMT_TO_RESULT(msg, msg, message);
+        FMT_TO_MESSAGE(msg, msg, message);
         InStream::quit(result, message.c_str());
     }
 }
@@ -3258,6 +4409,10 @@ void InStream::quitscrS(WORD color, std::string msg) {
 }
 
 void InStream::quitscr(WORD color, const char *msg) {
+#ifdef TESTLIB_THROW_ON_QUIT
+    if (TestlibFinalizeGuard::alive)
+        return;
+#endif
     if (resultName == "") {
         textColor(color);
         std::fprintf(stderr, "%s", msg);
@@ -3285,10 +4440,27 @@ void InStream::reset(std::FILE *file) {
         opened = true;
         __testlib_set_binary(file);
 
-        if (stdfile)
-            reader = new FileInputStreamReader(file, name);
-        else
-            reader = new BufferedFileInputStreamReader(file, name);
+        /*
+         * A checker never talks back through stdin, so it can be read in large chunks. An interactor
+         * reads its stdin with read(2) as well, taking each answer as soon as it arrives.
+         * A validator maps stdin when it is a regular file (the mapped reader keeps test cases too).
+         */
+        bool readStdinByChar = stdfile && testlibMode != _checker && testlibMode != _interactor;
+        reader = NULL;
+#ifdef __TESTLIB_USE_MMAP
+        if (!readStdinByChar || testlibMode == _validator) {
+            size_t size = 0;
+            char *data = MmapFileInputStreamReader::map(file, size);
+            if (NULL != data)
+                reader = new MmapFileInputStreamReader(file, name, data, size);
+        }
+#endif
+        if (NULL == reader) {
+            if (readStdinByChar)
+                reader = new FileInputStreamReader(file, name);
+            else
+                reader = new BufferedFileInputStreamReader(file, name, stdfile);
+        }
     } else {
         opened = false;
         reader = NULL;
@@ -3358,6 +4530,7 @@ char InStream::nextChar() {
 }
 
 char InStream::readChar() {
+    __testlib_read_scope profileScope(mode);
     return nextChar();
 }
 
@@ -3388,6 +4561,23 @@ void InStream::skipChar() {
 }
 
 void InStream::skipBlanks() {
+    __testlib_read_scope profileScope(mode, 0);
+    const char *data;
+    size_t size;
+    bool atEof;
+    if (reader->getSpan(data, size, atEof)) {
+        while (size > 0) {
+            size_t blanks = 0;
+            while (blanks < size && isBlanks(data[blanks]))
+                blanks++;
+            reader->skipSpan(blanks);
+            if (blanks < size || atEof)
+                break;
+            reader->getSpan(data, size, atEof);
+        }
+        return;
+    }
+
     while (isBlanks(reader->curChar()))
         reader->skipChar();
 }
@@ -3398,10 +4588,46 @@ std::string InStream::readWord() {
 }
 
 void InStream::readWordTo(std::string &result) {
+    __testlib_read_scope profileScope(mode);
     if (!strict)
         skipBlanks();
 
     lastLine = reader->getLine();
+
+    const char *data;
+    size_t size;
+    bool atEof;
+    if (reader->getSpan(data, size, atEof)) {
+        if (size == 0)
+            quit(_unexpected_eof, "Unexpected end of file - token expected");
+
+        if (isBlanks(data[0]))
+            quit(_pe, "Unexpected white-space - token expected");
+
+        result.clear();
+        while (true) {
+            size_t length = __testlib_tokenLength(data, size);
+
+            // You can change maxTokenLength.
+            // Example: 'inf.maxTokenLength = 128 * 1024 * 1024;'.
+            if (result.length() + length > maxTokenLength) {
+                result.append(data, maxTokenLength + 1 - result.length());
+                quitf(_pe, "Length of token exceeds %d, token is '%s...'", int(maxTokenLength),
+                      __testlib_part(result).c_str());
+            }
+
+            result.append(data, length);
+            reader->skipSpan(length);
+
+            if (length < size || atEof)
+                break;
+            reader->getSpan(data, size, atEof);
+            if (size == 0)
+                break;
+        }
+        return;
+    }
+
     int cur = reader->nextChar();
 
     if (cur == EOFC)
@@ -3434,6 +4660,28 @@ std::string InStream::readToken() {
     return readWord();
 }
 
+const char *InStream::readTokenView(size_t &length) {
+    __testlib_read_scope profileScope(mode);
+    if (!strict)
+        skipBlanks();
+
+    const char *data;
+    size_t size;
+    bool atEof;
+    if (reader->getSpan(data, size, atEof) && size > 0 && !isBlanks(data[0])) {
+        length = __testlib_tokenLength(data, size);
+        if ((length < size || atEof) && length <= maxTokenLength) {
+            lastLine = reader->getLine();
+            reader->skipSpan(length);
+            return data;
+        }
+    }
+
+    readWordTo(_tmpReadToken);
+    length = _tmpReadToken.length();
+    return _tmpReadToken.data();
+}
+
 void InStream::readTokenTo(std::string &result) {
     readWordTo(result);
 }
@@ -3443,15 +4691,12 @@ __attribute__((const))
 #endif
 static std::string __testlib_part(const std::string &s) {
     std::string t;
-    for (size_t i = 0; i < s.length(); i++)
-        if (s[i] != '\0')
-            t += s[i];
-        else
-            t += '~';
-    if (t.length() <= 64)
-        return t;
+    if (s.length() <= 64)
+        t = s;
     else
-        return t.substr(0, 30) + "..." + t.substr(s.length() - 31, 31);
+        t = s.substr(0, 30) + "..." + s.substr(s.length() - 31, 31);
+    std::replace(t.begin(), t.end(), '\0', '~');
+    return t;
 }
 
 #define __testlib_readMany(readMany, readOne, typeName, space)                  \
@@ -3514,12 +4759,12 @@ std::vector<std::string> InStream::readWords(int size, int indexBase) {
 }
 
 std::string InStream::readWord(const std::string &ptrn, const std::string &variableName) {
-    return readWord(pattern(ptrn), variableName);
+    return readWord(__testlib_pattern(ptrn), variableName);
 }
 
 std::vector<std::string>
 InStream::readWords(int size, const std::string &ptrn, const std::string &variablesName, int indexBase) {
-    pattern p(ptrn);
+    const pattern &p = __testlib_pattern(ptrn);
     if (strict && !variablesName.empty())
         validator.addVariable(variablesName);
     __testlib_readMany(readWords, readWord(p, variablesName), std::string, true);
@@ -3546,7 +4791,7 @@ std::string InStream::readToken(const std::string &ptrn, const std::string &vari
 
 std::vector<std::string>
 InStream::readTokens(int size, const std::string &ptrn, const std::string &variablesName, int indexBase) {
-    pattern p(ptrn);
+    const pattern &p = __testlib_pattern(ptrn);
     if (strict && !variablesName.empty())
         validator.addVariable(variablesName);
     __testlib_readMany(readTokens, readWord(p, variablesName), std::string, true);
@@ -3567,7 +4812,7 @@ void InStream::readWordTo(std::string &result, const pattern &p, const std::stri
 }
 
 void InStream::readWordTo(std::string &result, const std::string &ptrn, const std::string &variableName) {
-    return readWordTo(result, pattern(ptrn), variableName);
+    return readWordTo(result, __testlib_pattern(ptrn), variableName);
 }
 
 void InStream::readTokenTo(std::string &result, const pattern &p, const std::string &variableName) {
@@ -3643,10 +4888,62 @@ static inline bool equals(unsigned long long integer, const char *s) {
     return length == 0;
 }
 
-static inline double stringToDouble(InStream &in, const char *buffer) {
+/*
+ * Parses data[0..length) as a double in the notation accepted by strtod (callers check
+ * the allowed characters). Returns false unless the whole range is a number.
+ */
+static inline bool __testlib_parseDouble(const char *data, size_t length, double &result) {
+    if (length > 0 && data[0] == '+') {
+        if (length == 1 || data[1] == '+' || data[1] == '-')
+            return false;
+        data++, length--;
+    }
+
+    // sscanf("%lf") in glibc accepts a dangling exponent mark ("1e", "1e+"), keep it as before.
+    size_t mantissaLength = length;
+    if (mantissaLength >= 2 && (data[mantissaLength - 1] == '+' || data[mantissaLength - 1] == '-')
+            && (data[mantissaLength - 2] == 'e' || data[mantissaLength - 2] == 'E'))
+        mantissaLength -= 2;
+    else if (mantissaLength >= 1 && (data[mantissaLength - 1] == 'e' || data[mantissaLength - 1] == 'E'))
+        mantissaLength -= 1;
+    if (mantissaLength < length) {
+        for (size_t i = 0; i < mantissaLength; i++)
+            if (data[i] == 'e' || data[i] == 'E')
+                return false;
+        length = mantissaLength;
+    }
+
+#ifdef __TESTLIB_HAS_FROM_CHARS_DOUBLE
+    std::from_chars_result parsed = std::from_chars(data, data + length, result);
+    if (parsed.ec == std::errc())
+        return parsed.ptr == data + length;
+    if (parsed.ec != std::errc::result_out_of_range)
+        return false;
+    // Overflow or underflow: strtod gives +-HUGE_VAL or a denormal/zero, as sscanf did.
+#endif
+
+    char small[64];
+    std::string large;
+    const char *s;
+    if (length < sizeof(small)) {
+        std::memcpy(small, data, length);
+        small[length] = 0;
+        s = small;
+    } else {
+        large.assign(data, length);
+        s = large.c_str();
+    }
+
+    char *end;
+    result = std::strtod(s, &end);
+    return end != s && end == s + length;
+}
+
+static inline double stringToDouble(InStream &in, const char *buffer, size_t length) {
     double result;
 
-    size_t length = strlen(buffer);
+    if (NULL != std::memchr(buffer, 0, length))
+        in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found (it contains \\0)").c_str());
 
     int minusCount = 0;
     int plusCount = 0;
@@ -3669,41 +4966,34 @@ static inline double stringToDouble(InStream &in, const char *buffer) {
             if (buffer[i] == '.')
                 decimalPointCount++;
         } else
-            in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+            in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
     }
 
     // If for sure is not a number in standard notation or in e-notation.
     if (digitCount == 0 || minusCount > 2 || plusCount > 2 || decimalPointCount > 1 || eCount > 1)
-        in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found").c_str());
-
-    char *suffix = new char[length + 1];
-    std::memset(suffix, 0, length + 1);
-    int scanned;
-#ifdef _MSC_VER
-    scanned = sscanf_s(buffer, "%lf%s", &result, suffix, (unsigned int)(length + 1));
-#else
-    scanned = std::sscanf(buffer, "%lf%s", &result, suffix);
-#endif
-    bool empty = strlen(suffix) == 0;
-    delete[] suffix;
+        in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
-    if (scanned == 1 || (scanned == 2 && empty)) {
+    if (__testlib_parseDouble(buffer, length, result)) {
         if (__testlib_isNaN(result))
-            in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+            in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
         return result;
     } else
-        in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
+}
+
+static inline double stringToDouble(InStream &in, const char *buffer) {
+    return stringToDouble(in, buffer, strlen(buffer));
 }
 
 static inline double stringToDouble(InStream &in, const std::string& buffer) {
-    for (size_t i = 0; i < buffer.length(); i++)
-        if (buffer[i] == '\0')
-            in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found (it contains \\0)").c_str());
-    return stringToDouble(in, buffer.c_str());
+    return stringToDouble(in, buffer.data(), buffer.length());
 }
 
-static inline double stringToStrictDouble(InStream &in, const char *buffer,
+static inline double stringToStrictDouble(InStream &in, const char *buffer, size_t length,
         int minAfterPointDigitCount, int maxAfterPointDigitCount) {
+    if (NULL != std::memchr(buffer, 0, length))
+        in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found (it contains \\0)").c_str());
+
     if (minAfterPointDigitCount < 0)
         in.quit(_fail, "stringToStrictDouble: minAfterPointDigitCount should be non-negative.");
 
@@ -3713,27 +5003,25 @@ static inline double stringToStrictDouble(InStream &in, const char *buffer,
 
     double result;
 
-    size_t length = strlen(buffer);
-
     if (length == 0 || length > 1000)
-        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
     if (buffer[0] != '-' && (buffer[0] < '0' || buffer[0] > '9'))
-        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
     int pointPos = -1;
     for (size_t i = 1; i + 1 < length; i++) {
         if (buffer[i] == '.') {
             if (pointPos > -1)
-                in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+                in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
             pointPos = int(i);
         }
         if (buffer[i] != '.' && (buffer[i] < '0' || buffer[i] > '9'))
-            in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+            in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
     }
 
     if (buffer[length - 1] < '0' || buffer[length - 1] > '9')
-        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
     int afterDigitsCount = (pointPos == -1 ? 0 : int(length) - pointPos - 1);
     if (afterDigitsCount < minAfterPointDigitCount || afterDigitsCount > maxAfterPointDigitCount)
@@ -3741,7 +5029,7 @@ static inline double stringToStrictDouble(InStream &in, const char *buffer,
                       + vtos(minAfterPointDigitCount)
                       + ","
                       + vtos(maxAfterPointDigitCount)
-                      + "], but \"" + __testlib_part(buffer) + "\" found").c_str()
+                      + "], but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str()
         );
 
     int firstDigitPos = -1;
@@ -3752,143 +5040,349 @@ static inline double stringToStrictDouble(InStream &in, const char *buffer,
         }
 
     if (firstDigitPos > 1 || firstDigitPos == -1)
-        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
     if (buffer[firstDigitPos] == '0' && firstDigitPos + 1 < int(length)
         && buffer[firstDigitPos + 1] >= '0' && buffer[firstDigitPos + 1] <= '9')
-        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected strict double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
-    char *suffix = new char[length + 1];
-    std::memset(suffix, 0, length + 1);
-    int scanned;
-#ifdef _MSC_VER
-    scanned = sscanf_s(buffer, "%lf%s", &result, suffix, (unsigned int)(length + 1));
-#else
-    scanned = std::sscanf(buffer, "%lf%s", &result, suffix);
-#endif
-    bool empty = strlen(suffix) == 0;
-    delete[] suffix;
-
-    if (scanned == 1 || (scanned == 2 && empty)) {
+    if (__testlib_parseDouble(buffer, length, result)) {
         if (__testlib_isNaN(result) || __testlib_isInfinite(result))
-            in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+            in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
         if (buffer[0] == '-' && result >= 0)
-            in.quit(_pe, ("Redundant minus in \"" + __testlib_part(buffer) + "\" found").c_str());
+            in.quit(_pe, ("Redundant minus in \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
         return result;
     } else
-        in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected double, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
+}
+
+static inline double stringToStrictDouble(InStream &in, const char *buffer,
+        int minAfterPointDigitCount, int maxAfterPointDigitCount) {
+    return stringToStrictDouble(in, buffer, strlen(buffer), minAfterPointDigitCount, maxAfterPointDigitCount);
 }
 
 static inline double stringToStrictDouble(InStream &in, const std::string& buffer,
         int minAfterPointDigitCount, int maxAfterPointDigitCount) {
-    for (size_t i = 0; i < buffer.length(); i++)
-        if (buffer[i] == '\0')
-            in.quit(_pe, ("Expected double, but \"" + __testlib_part(buffer) + "\" found (it contains \\0)").c_str());
-    return stringToStrictDouble(in, buffer.c_str(), minAfterPointDigitCount, maxAfterPointDigitCount);
+    return stringToStrictDouble(in, buffer.data(), buffer.length(), minAfterPointDigitCount, maxAfterPointDigitCount);
 }
 
-static inline long long stringToLongLong(InStream &in, const char *buffer) {
-    size_t length = strlen(buffer);
+static inline long long stringToLongLong(InStream &in, const char *buffer, size_t length) {
+    if (NULL != std::memchr(buffer, 0, length))
+        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found (it contains \\0)").c_str());
+
     if (length == 0 || length > 20)
-        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
     bool has_minus = (length > 1 && buffer[0] == '-');
-    int zeroes = 0;
-    bool processingZeroes = true;
-
-    for (int i = (has_minus ? 1 : 0); i < int(length); i++) {
-        if (buffer[i] == '0' && processingZeroes)
-            zeroes++;
-        else
-            processingZeroes = false;
+    size_t first = has_minus ? 1 : 0;
+    unsigned long long limit = has_minus ? 9223372036854775808ULL : 9223372036854775807ULL;
+    unsigned long long value = 0;
 
+    for (size_t i = first; i < length; i++) {
         if (buffer[i] < '0' || buffer[i] > '9')
-            in.quit(_pe, ("Expected integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
-    }
+            in.quit(_pe, ("Expected integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
-    long long int result;
-    try {
-        result = std::stoll(buffer);
-    } catch (const std::exception&) {
-        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
-    } catch (...) {
-        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        unsigned long long digit = buffer[i] - '0';
+        if (value > (limit - digit) / 10)
+            in.quit(_pe, ("Expected integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
+        value = value * 10 + digit;
     }
 
-    if ((zeroes > 0 && (result != 0 || has_minus)) || zeroes > 1)
-        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
+    // Leading zeroes and "-0" are not allowed.
+    if (buffer[first] == '0' && (has_minus || length - first > 1))
+        in.quit(_pe, ("Expected integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
-    return result;
+    if (has_minus)
+        return value == 9223372036854775808ULL ? LLONG_MIN : -(long long) value;
+    return (long long) value;
+}
+
+static inline long long stringToLongLong(InStream &in, const char *buffer) {
+    return stringToLongLong(in, buffer, strlen(buffer));
 }
 
 static inline long long stringToLongLong(InStream &in, const std::string& buffer) {
-    for (size_t i = 0; i < buffer.length(); i++)
-        if (buffer[i] == '\0')
-            in.quit(_pe, ("Expected integer, but \"" + __testlib_part(buffer) + "\" found (it contains \\0)").c_str());
-    return stringToLongLong(in, buffer.c_str());
+    return stringToLongLong(in, buffer.data(), buffer.length());
 }
 
-static inline unsigned long long stringToUnsignedLongLong(InStream &in, const char *buffer) {
-    size_t length = strlen(buffer);
+static inline unsigned long long stringToUnsignedLongLong(InStream &in, const char *buffer, size_t length) {
+    if (NULL != std::memchr(buffer, 0, length))
+        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found (it contains \\0)").c_str());
 
     if (length == 0 || length > 20)
-        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
     if (length > 1 && buffer[0] == '0')
-        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
-    for (int i = 0; i < int(length); i++) {
+    unsigned long long value = 0;
+    for (size_t i = 0; i < length; i++) {
         if (buffer[i] < '0' || buffer[i] > '9')
-            in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
-    }
+            in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
 
-    unsigned long long result;
-    try {
-        result = std::stoull(buffer);
-    } catch (const std::exception&) {
-        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
-    } catch (...) {
-        in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(buffer) + "\" found").c_str());
+        unsigned long long digit = buffer[i] - '0';
+        if (value > (ULLONG_MAX - digit) / 10)
+            in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(std::string(buffer, length)) + "\" found").c_str());
+        value = value * 10 + digit;
     }
 
-    return result;
+    return value;
 }
 
-static inline long long stringToUnsignedLongLong(InStream &in, const std::string& buffer) {
-    for (size_t i = 0; i < buffer.length(); i++)
-        if (buffer[i] == '\0')
-            in.quit(_pe, ("Expected unsigned integer, but \"" + __testlib_part(buffer) + "\" found (it contains \\0)").c_str());
-    return stringToUnsignedLongLong(in, buffer.c_str());
+static inline unsigned long long stringToUnsignedLongLong(InStream &in, const char *buffer) {
+    return stringToUnsignedLongLong(in, buffer, strlen(buffer));
+}
+
+static inline long long stringToUnsignedLongLong(InStream &in, const std::string& buffer) {
+    return stringToUnsignedLongLong(in, buffer.data(), buffer.length());
+}
+
+/*
+ * Parsing for the batch readers (readIntsTo etc.): accepts only numbers in the usual
+ * form ("-12", "3.25") and never quits. Returns false if the token needs the full checks
+ * of stringToLongLong/stringToDouble.
+ */
+static inline bool __testlib_tryParseNumber(const char *data, size_t length, long long &result) {
+    bool minus = length > 1 && data[0] == '-';
+    size_t first = minus ? 1 : 0;
+    size_t digits = length - first;
+    if (digits == 0 || digits > 19 || (data[first] == '0' && (minus || digits > 1)))
+        return false;
+
+    unsigned long long value = 0;
+    for (size_t i = first; i < length; i++) {
+        unsigned int digit = (unsigned int) (data[i] - '0');
+        if (digit > 9)
+            return false;
+        value = value * 10 + digit;
+    }
+
+    if (value > (minus ? 9223372036854775808ULL : 9223372036854775807ULL))
+        return false;
+    result = minus ? (value == 9223372036854775808ULL ? LLONG_MIN : -(long long) value) : (long long) value;
+    return true;
+}
+
+static inline bool __testlib_tryParseNumber(const char *data, size_t length, int &result) {
+    long long value;
+    if (!__testlib_tryParseNumber(data, length, value) || value < INT_MIN || value > INT_MAX)
+        return false;
+    result = int(value);
+    return true;
+}
+
+static inline bool __testlib_tryParseNumber(const char *data, size_t length, double &result) {
+    size_t i = length > 1 && data[0] == '-' ? 1 : 0;
+    size_t integerDigits = 0;
+    while (i < length && data[i] >= '0' && data[i] <= '9')
+        i++, integerDigits++;
+    if (integerDigits == 0)
+        return false;
+    if (i < length) {
+        if (data[i] != '.' || i + 1 == length)
+            return false;
+        for (i++; i < length; i++)
+            if (data[i] < '0' || data[i] > '9')
+                return false;
+    }
+    return __testlib_parseDouble(data, length, result);
+}
+
+/* Parsing with all checks and messages of readInt()/readLong()/readDouble(). */
+static inline void __testlib_parseNumber(InStream &in, const char *data, size_t length, int &result) {
+    long long value = stringToLongLong(in, data, length);
+    if (value < INT_MIN || value > INT_MAX)
+        in.quit(_pe, ("Expected int32, but \"" + __testlib_part(std::string(data, length)) + "\" found").c_str());
+    result = int(value);
+}
+
+static inline void __testlib_parseNumber(InStream &in, const char *data, size_t length, long long &result) {
+    result = stringToLongLong(in, data, length);
+}
+
+static inline void __testlib_parseNumber(InStream &in, const char *data, size_t length, double &result) {
+    result = stringToDouble(in, data, length);
+}
+
+static inline void __testlib_readNumber(InStream &in, int &result) {
+    result = in.readInt();
+}
+
+static inline void __testlib_readNumber(InStream &in, long long &result) {
+    result = in.readLong();
+}
+
+static inline void __testlib_readNumber(InStream &in, double &result) {
+    result = in.readDouble();
+}
+
+/* Parts of the range violation messages and bounds hits, as in readInt(minv, maxv) and readDouble(minv, maxv). */
+static inline std::string __testlib_numberKind(int) {
+    return "Integer";
+}
+
+static inline std::string __testlib_numberKind(long long) {
+    return "Integer";
+}
+
+static inline std::string __testlib_numberKind(double) {
+    return "Double";
+}
+
+static inline std::string __testlib_rangeBound(int bound) {
+    return toHumanReadableString(bound);
+}
+
+static inline std::string __testlib_rangeBound(long long bound) {
+    return toHumanReadableString(bound);
+}
+
+static inline std::string __testlib_rangeBound(double bound) {
+    return vtos(bound);
+}
+
+/* Bounds hit of values in [lowest, highest] (the closest values to the bounds). */
+template<typename T>
+static inline ValidatorBoundsHit __testlib_boundsHit(T minv, T maxv, T lowest, T highest) {
+    return ValidatorBoundsHit(minv == lowest, maxv == highest);
+}
+
+static inline ValidatorBoundsHit __testlib_boundsHit(double minv, double maxv, double lowest, double highest) {
+    return ValidatorBoundsHit(
+            doubleDelta(minv, lowest) < ValidatorBoundsHit::EPS,
+            doubleDelta(maxv, highest) < ValidatorBoundsHit::EPS
+    );
+}
+
+void InStream::checkManySize(int size, const char *functionName) {
+    if (size < 0)
+        quit(_fail, (std::string(functionName) + ": size should be non-negative.").c_str());
+    if (size > 100000000)
+        quit(_fail, (std::string(functionName) + ": size should be at most 100000000.").c_str());
+}
+
+template<typename T>
+void InStream::readManyTo(T *result, int size, T minv, T maxv, bool checkRange,
+                          const std::string &variablesName, int indexBase) {
+    __testlib_read_scope profileScope(mode, size);
+    const int BLOCK_SIZE = 256;
+    int lines[BLOCK_SIZE];
+    bool bookkeeping = checkRange && strict && !variablesName.empty();
+    int variableId = bookkeeping ? validator.variableId(variablesName) : -1;
+    if (bookkeeping)
+        validator.addVariable(variableId);
+
+    // Elements before checked are range checked and accounted in the validator.
+    int checked = 0;
+    auto flush = [&](int upTo) {
+        if (checkRange && checked < upTo) {
+            T lowest = result[checked];
+            T highest = result[checked];
+            for (int k = checked + 1; k < upTo; k++) {
+                lowest = result[k] < lowest ? result[k] : lowest;
+                highest = result[k] > highest ? result[k] : highest;
+            }
+
+            int violation = upTo;
+            if (lowest < minv || highest > maxv) {
+                violation = checked;
+                while (result[violation] >= minv && result[violation] <= maxv)
+                    violation++;
+                lowest = maxv, highest = minv;
+                for (int k = checked; k < violation; k++) {
+                    lowest = result[k] < lowest ? result[k] : lowest;
+                    highest = result[k] > highest ? result[k] : highest;
+                }
+            }
+
+            if (bookkeeping && violation > checked) {
+                validator.addBoundsHit(variableId, __testlib_boundsHit(minv, maxv, lowest, highest));
+                validator.adjustConstantBounds(variableId, minv, maxv);
+                validator.addVariable(variableId);
+            }
+
+            if (violation < upTo) {
+                lastLine = lines[violation % BLOCK_SIZE];
+                readManyIteration = indexBase + violation;
+                quit(_wa, (__testlib_numberKind(minv) + " element "
+                           + (variablesName.empty() ? "[index=" + vtos(readManyIteration) + "]"
+                                                    : variablesName + "[" + vtos(readManyIteration) + "]")
+                           + " equals to " + vtos(result[violation]) + ", violates the range ["
+                           + __testlib_rangeBound(minv) + ", " + __testlib_rangeBound(maxv) + "]").c_str());
+            }
+        }
+        checked = upTo;
+    };
+
+    for (int i = 0; i < size;) {
+        readManyIteration = indexBase + i;
+
+        if (strict ? (reader->curChar() == EOFC || isBlanks(reader->curChar())) : seekEof()) {
+            // Let the one-element reader report the missing number.
+            flush(i);
+            __testlib_readNumber(*this, result[i]);
+        } else {
+            size_t length;
+            const char *token = readTokenView(length);
+            if (!__testlib_tryParseNumber(token, length, result[i])) {
+                flush(i);
+                __testlib_parseNumber(*this, token, length, result[i]);
+            }
+        }
+        lines[i % BLOCK_SIZE] = lastLine;
+        i++;
+
+        if (i - checked == BLOCK_SIZE)
+            flush(i);
+
+        if (strict && i < size) {
+            if (reader->curChar() == SPACE)
+                reader->skipChar();
+            else {
+                flush(i);
+                readSpace();
+            }
+        }
+    }
+
+    flush(size);
+    readManyIteration = NO_INDEX;
 }
 
 int InStream::readInteger() {
+    __testlib_read_scope profileScope(mode);
     if (!strict && seekEof())
         quit(_unexpected_eof, "Unexpected end of file - int32 expected");
 
-    readWordTo(_tmpReadToken);
+    size_t length;
+    const char *token = readTokenView(length);
 
-    long long value = stringToLongLong(*this, _tmpReadToken);
+    long long value = stringToLongLong(*this, token, length);
     if (value < INT_MIN || value > INT_MAX)
-        quit(_pe, ("Expected int32, but \"" + __testlib_part(_tmpReadToken) + "\" found").c_str());
+        quit(_pe, ("Expected int32, but \"" + __testlib_part(std::string(token, length)) + "\" found").c_str());
 
     return int(value);
 }
 
 long long InStream::readLong() {
+    __testlib_read_scope profileScope(mode);
     if (!strict && seekEof())
         quit(_unexpected_eof, "Unexpected end of file - int64 expected");
 
-    readWordTo(_tmpReadToken);
+    size_t length;
+    const char *token = readTokenView(length);
 
-    return stringToLongLong(*this, _tmpReadToken);
+    return stringToLongLong(*this, token, length);
 }
 
 unsigned long long InStream::readUnsignedLong() {
+    __testlib_read_scope profileScope(mode);
     if (!strict && seekEof())
         quit(_unexpected_eof, "Unexpected end of file - int64 expected");
 
-    readWordTo(_tmpReadToken);
+    size_t length;
+    const char *token = readTokenView(length);
 
-    return stringToUnsignedLongLong(*this, _tmpReadToken);
+    return stringToUnsignedLongLong(*this, token, length);
 }
 
 long long InStream::readLong(long long minv, long long maxv, const std::string &variableName) {
@@ -3914,9 +5408,10 @@ long long InStream::readLong(long long minv, long long maxv, const std::string &
     }
 
     if (strict && !variableName.empty()) {
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
-        validator.adjustConstantBounds(variableName, minv, maxv);
-        validator.addVariable(variableName);
+        int variableId = validator.variableId(variableName);
+        validator.addBoundsHit(variableId, ValidatorBoundsHit(minv == result, maxv == result));
+        validator.adjustConstantBounds(variableId, minv, maxv);
+        validator.addVariable(variableId);
     }
 
     return result;
@@ -3924,13 +5419,17 @@ long long InStream::readLong(long long minv, long long maxv, const std::string &
 
 std::vector<long long>
 InStream::readLongs(int size, long long minv, long long maxv, const std::string &variablesName, int indexBase) {
-    if (strict && !variablesName.empty())
-        validator.addVariable(variablesName);
-    __testlib_readMany(readLongs, readLong(minv, maxv, variablesName), long long, true)
+    checkManySize(size, "readLongs");
+    std::vector<long long> result(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+    return result;
 }
 
 std::vector<long long> InStream::readLongs(int size, int indexBase) {
-    __testlib_readMany(readLongs, readLong(), long long, true)
+    checkManySize(size, "readLongs");
+    std::vector<long long> result(size);
+    readManyTo(result.data(), size, 0LL, 0LL, false, "", indexBase);
+    return result;
 }
 
 unsigned long long
@@ -3960,9 +5459,10 @@ InStream::readUnsignedLong(unsigned long long minv, unsigned long long maxv, con
     }
 
     if (strict && !variableName.empty()) {
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
-        validator.adjustConstantBounds(variableName, minv, maxv);
-        validator.addVariable(variableName);
+        int variableId = validator.variableId(variableName);
+        validator.addBoundsHit(variableId, ValidatorBoundsHit(minv == result, maxv == result));
+        validator.adjustConstantBounds(variableId, minv, maxv);
+        validator.addVariable(variableId);
     }
 
     return result;
@@ -4011,9 +5511,10 @@ int InStream::readInt(int minv, int maxv, const std::string &variableName) {
     }
 
     if (strict && !variableName.empty()) {
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
-        validator.adjustConstantBounds(variableName, minv, maxv);
-        validator.addVariable(variableName);
+        int variableId = validator.variableId(variableName);
+        validator.addBoundsHit(variableId, ValidatorBoundsHit(minv == result, maxv == result));
+        validator.adjustConstantBounds(variableId, minv, maxv);
+        validator.addVariable(variableId);
     }
 
     return result;
@@ -4024,30 +5525,42 @@ int InStream::readInteger(int minv, int maxv, const std::string &variableName) {
 }
 
 std::vector<int> InStream::readInts(int size, int minv, int maxv, const std::string &variablesName, int indexBase) {
-    if (strict && !variablesName.empty())
-        validator.addVariable(variablesName);
-    __testlib_readMany(readInts, readInt(minv, maxv, variablesName), int, true)
+    checkManySize(size, "readInts");
+    std::vector<int> result(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+    return result;
 }
 
 std::vector<int> InStream::readInts(int size, int indexBase) {
-    __testlib_readMany(readInts, readInt(), int, true)
+    checkManySize(size, "readInts");
+    std::vector<int> result(size);
+    readManyTo(result.data(), size, 0, 0, false, "", indexBase);
+    return result;
 }
 
 std::vector<int> InStream::readIntegers(int size, int minv, int maxv, const std::string &variablesName, int indexBase) {
-    if (strict && !variablesName.empty())
-        validator.addVariable(variablesName);
-    __testlib_readMany(readIntegers, readInt(minv, maxv, variablesName), int, true)
+    checkManySize(size, "readIntegers");
+    std::vector<int> result(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+    return result;
 }
 
 std::vector<int> InStream::readIntegers(int size, int indexBase) {
-    __testlib_readMany(readIntegers, readInt(), int, true)
+    checkManySize(size, "readIntegers");
+    std::vector<int> result(size);
+    readManyTo(result.data(), size, 0, 0, false, "", indexBase);
+    return result;
 }
 
 double InStream::readReal() {
+    __testlib_read_scope profileScope(mode);
     if (!strict && seekEof())
         quit(_unexpected_eof, "Unexpected end of file - double expected");
 
-    return stringToDouble(*this, readWord());
+    size_t length;
+    const char *token = readTokenView(length);
+
+    return stringToDouble(*this, token, length);
 }
 
 double InStream::readDouble() {
@@ -4077,12 +5590,13 @@ double InStream::readReal(double minv, double maxv, const std::string &variableN
     }
 
     if (strict && !variableName.empty()) {
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(
+        int variableId = validator.variableId(variableName);
+        validator.addBoundsHit(variableId, ValidatorBoundsHit(
                 doubleDelta(minv, result) < ValidatorBoundsHit::EPS,
                 doubleDelta(maxv, result) < ValidatorBoundsHit::EPS
         ));
-        validator.adjustConstantBounds(variableName, minv, maxv);
-        validator.addVariable(variableName);
+        validator.adjustConstantBounds(variableId, minv, maxv);
+        validator.addVariable(variableId);
     }
     
     return result;
@@ -4090,13 +5604,17 @@ double InStream::readReal(double minv, double maxv, const std::string &variableN
 
 std::vector<double>
 InStream::readReals(int size, double minv, double maxv, const std::string &variablesName, int indexBase) {
-    if (strict && !variablesName.empty())
-        validator.addVariable(variablesName);
-    __testlib_readMany(readReals, readReal(minv, maxv, variablesName), double, true)
+    checkManySize(size, "readReals");
+    std::vector<double> result(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+    return result;
 }
 
 std::vector<double> InStream::readReals(int size, int indexBase) {
-    __testlib_readMany(readReals, readReal(), double, true)
+    checkManySize(size, "readReals");
+    std::vector<double> result(size);
+    readManyTo(result.data(), size, 0.0, 0.0, false, "", indexBase);
+    return result;
 }
 
 double InStream::readDouble(double minv, double maxv, const std::string &variableName) {
@@ -4105,13 +5623,89 @@ double InStream::readDouble(double minv, double maxv, const std::string &variabl
 
 std::vector<double>
 InStream::readDoubles(int size, double minv, double maxv, const std::string &variablesName, int indexBase) {
-    if (strict && !variablesName.empty())
-        validator.addVariable(variablesName);
-    __testlib_readMany(readDoubles, readDouble(minv, maxv, variablesName), double, true)
+    checkManySize(size, "readDoubles");
+    std::vector<double> result(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+    return result;
 }
 
 std::vector<double> InStream::readDoubles(int size, int indexBase) {
-    __testlib_readMany(readDoubles, readDouble(), double, true)
+    checkManySize(size, "readDoubles");
+    std::vector<double> result(size);
+    readManyTo(result.data(), size, 0.0, 0.0, false, "", indexBase);
+    return result;
+}
+
+void InStream::readIntsTo(int *result, int size, int minv, int maxv, const std::string &variablesName,
+                          int indexBase) {
+    checkManySize(size, "readIntsTo");
+    readManyTo(result, size, minv, maxv, true, variablesName, indexBase);
+}
+
+void InStream::readIntsTo(int *result, int size, int indexBase) {
+    checkManySize(size, "readIntsTo");
+    readManyTo(result, size, 0, 0, false, "", indexBase);
+}
+
+void InStream::readIntsTo(std::vector<int> &result, int size, int minv, int maxv, const std::string &variablesName,
+                          int indexBase) {
+    checkManySize(size, "readIntsTo");
+    result.resize(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+}
+
+void InStream::readIntsTo(std::vector<int> &result, int size, int indexBase) {
+    checkManySize(size, "readIntsTo");
+    result.resize(size);
+    readManyTo(result.data(), size, 0, 0, false, "", indexBase);
+}
+
+void InStream::readLongsTo(long long *result, int size, long long minv, long long maxv,
+                           const std::string &variablesName, int indexBase) {
+    checkManySize(size, "readLongsTo");
+    readManyTo(result, size, minv, maxv, true, variablesName, indexBase);
+}
+
+void InStream::readLongsTo(long long *result, int size, int indexBase) {
+    checkManySize(size, "readLongsTo");
+    readManyTo(result, size, 0LL, 0LL, false, "", indexBase);
+}
+
+void InStream::readLongsTo(std::vector<long long> &result, int size, long long minv, long long maxv,
+                           const std::string &variablesName, int indexBase) {
+    checkManySize(size, "readLongsTo");
+    result.resize(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+}
+
+void InStream::readLongsTo(std::vector<long long> &result, int size, int indexBase) {
+    checkManySize(size, "readLongsTo");
+    result.resize(size);
+    readManyTo(result.data(), size, 0LL, 0LL, false, "", indexBase);
+}
+
+void InStream::readDoublesTo(double *result, int size, double minv, double maxv, const std::string &variablesName,
+                             int indexBase) {
+    checkManySize(size, "readDoublesTo");
+    readManyTo(result, size, minv, maxv, true, variablesName, indexBase);
+}
+
+void InStream::readDoublesTo(double *result, int size, int indexBase) {
+    checkManySize(size, "readDoublesTo");
+    readManyTo(result, size, 0.0, 0.0, false, "", indexBase);
+}
+
+void InStream::readDoublesTo(std::vector<double> &result, int size, double minv, double maxv,
+                             const std::string &variablesName, int indexBase) {
+    checkManySize(size, "readDoublesTo");
+    result.resize(size);
+    readManyTo(result.data(), size, minv, maxv, true, variablesName, indexBase);
+}
+
+void InStream::readDoublesTo(std::vector<double> &result, int size, int indexBase) {
+    checkManySize(size, "readDoublesTo");
+    result.resize(size);
+    readManyTo(result.data(), size, 0.0, 0.0, false, "", indexBase);
 }
 
 double InStream::readStrictReal(double minv, double maxv,
@@ -4120,7 +5714,9 @@ double InStream::readStrictReal(double minv, double maxv,
     if (!strict && seekEof())
         quit(_unexpected_eof, "Unexpected end of file - strict double expected");
 
-    double result = stringToStrictDouble(*this, readWord(), minAfterPointDigitCount, maxAfterPointDigitCount);
+    size_t length;
+    const char *token = readTokenView(length);
+    double result = stringToStrictDouble(*this, token, length, minAfterPointDigitCount, maxAfterPointDigitCount);
 
     if (result < minv || result > maxv) {
         if (readManyIteration == NO_INDEX) {
@@ -4143,12 +5739,13 @@ double InStream::readStrictReal(double minv, double maxv,
     }
 
     if (strict && !variableName.empty()) {
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(
+        int variableId = validator.variableId(variableName);
+        validator.addBoundsHit(variableId, ValidatorBoundsHit(
                 doubleDelta(minv, result) < ValidatorBoundsHit::EPS,
                 doubleDelta(maxv, result) < ValidatorBoundsHit::EPS
         ));
-        validator.adjustConstantBounds(variableName, minv, maxv);
-        validator.addVariable(variableName);
+        validator.adjustConstantBounds(variableId, minv, maxv);
+        validator.addVariable(variableId);
     }
 
     return result;
@@ -4190,6 +5787,7 @@ bool InStream::eof() {
 }
 
 bool InStream::seekEof() {
+    __testlib_read_scope profileScope(mode, 0);
     if (!strict && NULL == reader)
         return true;
     skipBlanks();
@@ -4247,12 +5845,14 @@ bool InStream::eoln() {
 }
 
 void InStream::readEoln() {
+    __testlib_read_scope profileScope(mode, 0);
     lastLine = reader->getLine();
     if (!eoln())
         quit(_pe, "Expected EOLN");
 }
 
 void InStream::readEof() {
+    __testlib_read_scope profileScope(mode, 0);
     lastLine = reader->getLine();
     if (!eof())
         quit(_pe, "Expected EOF");
@@ -4262,6 +5862,7 @@ void InStream::readEof() {
 }
 
 bool InStream::seekEoln() {
+    __testlib_read_scope profileScope(mode, 0);
     if (!strict && NULL == reader)
         return true;
 
@@ -4279,6 +5880,7 @@ void InStream::nextLine() {
 }
 
 void InStream::readStringTo(std::string &result) {
+    __testlib_read_scope profileScope(mode);
     if (NULL == reader)
         quit(_pe, "Expected line");
 
@@ -4343,7 +5945,7 @@ void InStream::readStringTo(std::string &result, const pattern &p, const std::st
 }
 
 void InStream::readStringTo(std::string &result, const std::string &ptrn, const std::string &variableName) {
-    readStringTo(result, pattern(ptrn), variableName);
+    readStringTo(result, __testlib_pattern(ptrn), variableName);
 }
 
 std::string InStream::readString(const pattern &p, const std::string &variableName) {
@@ -4365,7 +5967,7 @@ std::string InStream::readString(const std::string &ptrn, const std::string &var
 
 std::vector<std::string>
 InStream::readStrings(int size, const std::string &ptrn, const std::string &variablesName, int indexBase) {
-    pattern p(ptrn);
+    const pattern &p = __testlib_pattern(ptrn);
     if (strict && !variablesName.empty())
         validator.addVariable(variablesName);
     __testlib_readMany(readStrings, readString(p, variablesName), std::string, false)
@@ -4408,7 +6010,7 @@ std::string InStream::readLine(const std::string &ptrn, const std::string &varia
 
 std::vector<std::string>
 InStream::readLines(int size, const std::string &ptrn, const std::string &variablesName, int indexBase) {
-    pattern p(ptrn);
+    const pattern &p = __testlib_pattern(ptrn);
     if (strict && !variablesName.empty())
         validator.addVariable(variablesName);
     __testlib_readMany(readLines, readString(p, variablesName), std::string, false)
@@ -4419,7 +6021,7 @@ __attribute__ ((format (printf, 3, 4)))
 #endif
 void InStream::ensuref(bool cond, const char *format, ...) {
     if (!cond) {
-        FMT_TO_RESULT(format, format, message);
+        FMT_TO_MESSAGE(format, format, message);
         this->__testlib_ensure(cond, message);
     }
 }
@@ -4431,6 +6033,7 @@ void InStream::__testlib_ensure(bool cond, std::string message) {
 
 void InStream::close() {
     if (NULL != reader) {
+        __testlib_profile.bytes[mode] += reader->bytesRead();
         reader->close();
         delete reader;
         reader = NULL;
@@ -4439,6 +6042,38 @@ void InStream::close() {
     opened = false;
 }
 
+void __testlib_writeProfile() {
+    /* Indexed by TMode, streams still open add what their readers took so far. */
+    const char *names[3] = {"inf", "ouf", "ans"};
+    unsigned long long bytes[3];
+    for (int i = 0; i < 3; i++)
+        bytes[i] = __testlib_profile.bytes[i];
+    InStream *streams[3] = {&inf, &ouf, &ans};
+    for (int i = 0; i < 3; i++)
+        if (NULL != streams[i]->reader)
+            bytes[streams[i]->mode] += streams[i]->reader->bytesRead();
+
+    __testlib_profile_t &p = __testlib_profile;
+    double total = __testlib_profile_t::now() - p.start;
+    double parse = __testlib_max(0.0, p.readSeconds - p.refillInReadSeconds);
+    double user = __testlib_max(0.0, total - p.readSeconds - (p.refillSeconds - p.refillInReadSeconds));
+
+    long long peakRssKb = 0;
+#if !defined(ON_WINDOWS)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        peakRssKb = (long long) usage.ru_maxrss;
+#endif
+
+    std::string record = "testlib-profile: {";
+    for (int i = 0; i < 3; i++)
+        record += testlib_format_("\"%s\": {\"bytes\": %llu, \"tokens\": %llu}, ", names[i], bytes[i], p.tokens[i]);
+    record += testlib_format_("\"refillMs\": %.3f, \"parseMs\": %.3f, \"userMs\": %.3f, \"peakRssKb\": %lld}\n",
+                              p.refillSeconds * 1000.0, parse * 1000.0, user * 1000.0, peakRssKb);
+    std::fputs(record.c_str(), stderr);
+    std::fflush(stderr);
+}
+
 NORETURN void quit(TResult result, const std::string &msg) {
     ouf.quit(result, msg.c_str());
 }
@@ -4520,7 +6155,7 @@ template<typename F>
 __attribute__ ((format (printf, 2, 3)))
 #endif
 NORETURN void quitp(F points, const char *format, ...) {
-    FMT_TO_RESULT(format, format, message);
+    FMT_TO_MESSAGE(format, format, message);
     quitp(points, message);
 }
 
@@ -4528,7 +6163,7 @@ NORETURN void quitp(F points, const char *format, ...) {
 __attribute__ ((format (printf, 2, 3)))
 #endif
 NORETURN void quitf(TResult result, const char *format, ...) {
-    FMT_TO_RESULT(format, format, message);
+    FMT_TO_MESSAGE(format, format, message);
     quit(result, message);
 }
 
@@ -4537,7 +6172,7 @@ __attribute__ ((format (printf, 3, 4)))
 #endif
 void quitif(bool condition, TResult result, const char *format, ...) {
     if (condition) {
-        FMT_TO_RESULT(format, format, message);
+        FMT_TO_MESSAGE(format, format, message);
         quit(result, message);
     }
 }
@@ -4612,8 +6247,8 @@ static void __testlib_set_testset_and_group(int argc, char* argv[]) {
 }
 
 void registerGen(int argc, char *argv[], int randomGeneratorVersion) {
-    if (randomGeneratorVersion < 0 || randomGeneratorVersion > 1)
-        quitf(_fail, "Random generator version is expected to be 0 or 1.");
+    if (randomGeneratorVersion < 0 || randomGeneratorVersion > 2)
+        quitf(_fail, "Random generator version is expected to be 0, 1 or 2.");
     random_t::version = randomGeneratorVersion;
 
     __testlib_ensuresPreconditions();
@@ -4683,6 +6318,8 @@ void setAppesModeEncoding(std::string appesModeEncoding) {
     ::appesModeEncoding = appesModeEncoding;
 }
 
+static void __testlib_flushInteraction();
+
 void registerInteraction(int argc, char *argv[]) {
     __testlib_ensuresPreconditions();
     __testlib_set_testset_and_group(argc, argv);
@@ -4729,6 +6366,7 @@ void registerInteraction(int argc, char *argv[]) {
         quit(_fail, std::string("Can not write to the test-output-file '") + argv[2] + std::string("'"));
 
     ouf.init(stdin, _output);
+    __testlib_beforeInteractiveRead = __testlib_flushInteraction;
 
     if (argc >= 4)
         ans.init(argv[3], _answer);
@@ -4736,6 +6374,211 @@ void registerInteraction(int argc, char *argv[]) {
         ans.name = "unopened answer stream";
 }
 
+#ifndef ON_WINDOWS
+/*
+ * Reads everything a forked run writes to messageFd, waits for it and returns its exit code (-1 if killed).
+ * With wallLimitMs > 0 the run is killed when it takes longer, *timedOut tells if it was killed
+ * for that or for its CPU limit (SIGXCPU).
+ */
+static int __testlib_collectForked(pid_t pid, int messageFd, std::string &message,
+                                   int wallLimitMs = 0, bool *timedOut = NULL) {
+    message.clear();
+    if (NULL != timedOut)
+        *timedOut = false;
+    std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(wallLimitMs);
+    char buffer[4096];
+    while (true) {
+        if (wallLimitMs > 0) {
+            long long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+            struct pollfd pfd;
+            pfd.fd = messageFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int ready = remaining > 0 ? poll(&pfd, 1, int(remaining)) : 0;
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready == 0) {
+                kill(pid, SIGKILL);
+                if (NULL != timedOut)
+                    *timedOut = true;
+                break;
+            }
+        }
+        ssize_t result = read(messageFd, buffer, sizeof(buffer));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        message.append(buffer, size_t(result));
+    }
+    close(messageFd);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+    if (NULL != timedOut && WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU)
+        *timedOut = true;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Limits the CPU time of a forked run to timeLimitMs (rounded up to seconds), it gets SIGXCPU then. */
+static void __testlib_limitForkedCpu(int timeLimitMs) {
+    if (timeLimitMs <= 0)
+        return;
+    struct rlimit limit;
+    limit.rlim_cur = rlim_t((timeLimitMs + 999) / 1000);
+    limit.rlim_max = limit.rlim_cur + 1;
+    setrlimit(RLIMIT_CPU, &limit);
+}
+
+/* Prepares a forked run: stderr goes to messageFd, stdout is dropped. */
+static void __testlib_redirectForked(int messageFd) {
+    dup2(messageFd, STDERR_FILENO);
+    close(messageFd);
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull >= 0) {
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+    }
+}
+
+static std::string __testlib_jsonString(const std::string &s) {
+    std::string result = "\"";
+    for (size_t i = 0; i < s.length(); i++) {
+        unsigned char c = (unsigned char) s[i];
+        if (c == '"' || c == '\\')
+            result += '\\', result += char(c);
+        else if (c == LF)
+            result += "\\n";
+        else if (c < 32)
+            result += testlib_format_("\\u%04x", int(c));
+        else
+            result += char(c);
+    }
+    return result + "\"";
+}
+
+/*
+ * Validator batch mode, "--batch <list-file>": validates every file listed in <list-file>
+ * (one name per line) in one run. Each file is validated by a forked copy of the process
+ * with the file as stdin, so inf and the Validator state start fresh for every file.
+ * The results go to stdout as one JSON array, in list order:
+ * [{"file": "...", "exitCode": 0, "message": "..."}, ...]
+ * With --testOverviewLogFileName every copy writes the overview of its own file there, and the
+ * entry gets it as "overview" (the file is removed), so the caller can keep per-file overviews.
+ * With "--batchTimeLimit <ms>" every copy gets <ms> of CPU time and twice that of wall time;
+ * a copy exceeding them is killed and its entry gets "timeLimitExceeded": true, the other files
+ * are validated as usual.
+ * Returns only in the forked copy; the batch process itself exits when all files are done.
+ */
+static void __testlib_validateBatch(int argc, char *argv[]) {
+    const char *listFileName = NULL;
+    const char *overviewFileName = NULL;
+    int timeLimitMs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp("--batch", argv[i])) {
+            if (i + 1 < argc)
+                listFileName = argv[++i];
+            else
+                quit(_fail, "Expected list file after --batch command line parameter");
+        } else if (!strcmp("--testOverviewLogFileName", argv[i]) && i + 1 < argc)
+            overviewFileName = argv[++i];
+        else if (!strcmp("--batchTimeLimit", argv[i])) {
+            long long value = i + 1 < argc ? atoll(argv[++i]) : 0;
+            if (value <= 0 || value > 1000000000LL)
+                quit(_fail, "Expected time limit in milliseconds after --batchTimeLimit command line parameter");
+            timeLimitMs = int(value);
+        }
+    }
+    if (NULL == listFileName)
+        return;
+    if (NULL != overviewFileName && (!strcmp("stdout", overviewFileName) || !strcmp("stderr", overviewFileName)))
+        quit(_fail, "Validator batch: --testOverviewLogFileName must be a file");
+
+    __testlib_ensuresPreconditions();
+    TestlibFinalizeGuard::registered = true;
+
+    std::ifstream list(listFileName);
+    if (!list.is_open())
+        quit(_fail, std::string("Can't open batch list file '") + listFileName + "'");
+    std::vector<std::string> fileNames;
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line[line.length() - 1] == CR)
+            line.erase(line.length() - 1);
+        if (!line.empty())
+            fileNames.push_back(line);
+    }
+
+    std::string report = "[";
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        int exitCode;
+        bool timedOut = false;
+        std::string message;
+        if (NULL != overviewFileName)
+            std::remove(overviewFileName);
+        int inputFd = open(fileNames[i].c_str(), O_RDONLY);
+        if (inputFd < 0) {
+            exitCode = resultExitCode(_fail);
+            message = "FAIL Can't open input file";
+        } else {
+            int messagePipe[2];
+            if (pipe(messagePipe) != 0)
+                quit(_fail, "Validator batch: can't create pipe");
+
+            std::fflush(stdout);
+            std::fflush(stderr);
+            pid_t pid = fork();
+            if (pid < 0)
+                quit(_fail, "Validator batch: can't fork");
+
+            if (pid == 0) {
+                close(messagePipe[0]);
+                __testlib_redirectForked(messagePipe[1]);
+                dup2(inputFd, STDIN_FILENO);
+                close(inputFd);
+                __testlib_limitForkedCpu(timeLimitMs);
+                // With TESTLIB_PROFILE the record of this file ends its message
+                __testlib_profile = __testlib_profile_t();
+                return;
+            }
+
+            close(inputFd);
+            close(messagePipe[1]);
+            exitCode = __testlib_collectForked(pid, messagePipe[0], message,
+                                               timeLimitMs > 0 ? 2 * timeLimitMs : 0, &timedOut);
+        }
+
+        report += i == 0 ? "\n" : ",\n";
+        report += "{\"file\": " + __testlib_jsonString(fileNames[i])
+                  + ", \"exitCode\": " + vtos(exitCode)
+                  + ", \"message\": " + __testlib_jsonString(trim(message));
+        if (timedOut)
+            report += ", \"timeLimitExceeded\": true";
+        if (NULL != overviewFileName) {
+            std::string overview;
+            FILE *overviewFile = timedOut ? NULL : testlib_fopen_(overviewFileName, "rb");
+            if (NULL != overviewFile) {
+                char buffer[4096];
+                size_t length;
+                while ((length = std::fread(buffer, 1, sizeof(buffer), overviewFile)) > 0)
+                    overview.append(buffer, length);
+                std::fclose(overviewFile);
+            }
+            std::remove(overviewFileName);
+            report += ", \"overview\": " + __testlib_jsonString(overview);
+        }
+        report += "}";
+    }
+    report += "\n]\n";
+
+    std::fputs(report.c_str(), stdout);
+    std::fflush(stdout);
+    std::exit(EXIT_SUCCESS);
+}
+#endif
+
 void registerValidation() {
     __testlib_ensuresPreconditions();
     TestlibFinalizeGuard::registered = true;
@@ -4750,7 +6593,27 @@ void registerValidation() {
     inf.strict = true;
 }
 
+/* "--inputFile <file>": the validator reads <file> instead of stdin (ignored in batch mode). */
+static void __testlib_openValidationInput(int argc, char *argv[]) {
+    const char *inputFileName = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp("--batch", argv[i]))
+            return;
+        if (!strcmp("--inputFile", argv[i]) && i + 1 < argc)
+            inputFileName = argv[++i];
+    }
+    if (NULL != inputFileName && NULL == std::freopen(inputFileName, "rb", stdin)) {
+        __testlib_ensuresPreconditions();
+        TestlibFinalizeGuard::registered = true;
+        quit(_fail, std::string("Can't open input file '") + inputFileName + "'");
+    }
+}
+
 void registerValidation(int argc, char *argv[]) {
+#ifndef ON_WINDOWS
+    __testlib_validateBatch(argc, argv);
+#endif
+    __testlib_openValidationInput(argc, argv);
     registerValidation();
     __testlib_set_testset_and_group(argc, argv);
 
@@ -4764,6 +6627,9 @@ void registerValidation(int argc, char *argv[]) {
                             " [--testMarkupFileName fileName]"
                             " [--testCase testCase]"
                             " [--testCaseFileName fileName]"
+                            " [--batch listFileName]"
+                            " [--batchTimeLimit ms]"
+                            " [--inputFile fileName]"
                             ;
 
     for (int i = 1; i < argc; i++) {
@@ -4807,6 +6673,12 @@ void registerValidation(int argc, char *argv[]) {
             } else
                 quit(_fail, comment);
         }
+        if (!strcmp("--batch", argv[i]) || !strcmp("--batchTimeLimit", argv[i]) || !strcmp("--inputFile", argv[i])) {
+            if (i + 1 < argc)
+                i++;
+            else
+                quit(_fail, comment);
+        }
     }
 }
 
@@ -4857,6 +6729,8 @@ public:
     }
 } checker;
 
+bool __testlib_streamOutput = false;
+
 void registerTestlibCmd(int argc, char *argv[]) {
     __testlib_ensuresPreconditions();
     __testlib_set_testset_and_group(argc, argv);
@@ -4916,11 +6790,151 @@ void registerTestlibCmd(int argc, char *argv[]) {
 #endif
 
     inf.init(args[1], _input);
-    ouf.init(args[2], _output);
+    if (__testlib_streamOutput && "-" == args[2])
+        ouf.init(stdin, _output);
+    else
+        ouf.init(args[2], _output);
     ouf.skipBom();
     ans.init(args[3], _answer);
 }
 
+/*
+ * Same as registerTestlibCmd(argc, argv), but the output file may be given as "-":
+ * the participant's output is read from stdin while the solution is still writing it.
+ * The checker quits on the first mismatch, so the caller can stop the solution as soon
+ * as the checker exits. With a regular output file it behaves like registerTestlibCmd.
+ */
+void registerTestlibStream(int argc, char *argv[]) {
+    __testlib_streamOutput = true;
+    registerTestlibCmd(argc, argv);
+}
+
+/*
+ * Prepares the next test of an in-process checker: closes the streams of the previous test,
+ * resets the per-test state (points, test case, last read line/index) and opens inf/ouf/ans.
+ * Together with TESTLIB_THROW_ON_QUIT one process can check any number of tests.
+ */
+void resetTestlib(const std::string &inputFileName, const std::string &outputFileName,
+                  const std::string &answerFileName) {
+    if (testlibMode == _unknown) {
+        __testlib_ensuresPreconditions();
+        testlibMode = _checker;
+        checker.initialize();
+    }
+    if (testlibMode != _checker)
+        __testlib_fail("resetTestlib can be used only in checkers");
+    TestlibFinalizeGuard::registered = true;
+
+    InStream *streams[] = {&inf, &ouf, &ans};
+    for (InStream *stream : streams) {
+        stream->close();
+        stream->lastLine = -1;
+        stream->readManyIteration = InStream::NO_INDEX;
+    }
+    if (tout.is_open())
+        tout.close();
+
+    __testlib_points = std::numeric_limits<float>::infinity();
+    unsetTestCase();
+
+    inf.init(inputFileName, _input);
+    ouf.init(outputFileName, _output);
+    ouf.skipBom();
+    ans.init(answerFileName, _answer);
+}
+
+#ifndef ON_WINDOWS
+static bool __testlib_readControlLine(std::string &line) {
+    /* Unbuffered on purpose: forked checkers must not share a stdio buffer of the control stream. */
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t result = read(STDIN_FILENO, &c, 1);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return !line.empty();
+        if (c == LF)
+            break;
+        if (c != CR)
+            line += c;
+    }
+    return true;
+}
+#endif
+
+/*
+ * Checker server: one process checks many tests. Without file arguments it reads
+ * <input-file>, <output-file> and <answer-file> lines from stdin, runs the checker for each
+ * triple in a forked copy of the process (so inf/ouf/ans and the quit machinery start from
+ * scratch) and writes one line "<exit-code> <message>" per test to stdout. It stops at the
+ * end of stdin. With file arguments it behaves like registerTestlibCmd(argc, argv).
+ */
+void registerTestlibServer(int argc, char *argv[]) {
+    int fileArgs = 0;
+    for (int i = 1; i < argc; i++)
+        if (!strcmp("--testset", argv[i]) || !strcmp("--group", argv[i]))
+            i++;
+        else
+            fileArgs++;
+
+    if (fileArgs > 0) {
+        registerTestlibCmd(argc, argv);
+        return;
+    }
+
+#ifdef ON_WINDOWS
+    quit(_fail, "Checker server mode is not supported on Windows");
+#else
+    __testlib_ensuresPreconditions();
+    TestlibFinalizeGuard::registered = true;
+
+    while (true) {
+        std::string fileNames[3];
+        for (int i = 0; i < 3; i++)
+            if (!__testlib_readControlLine(fileNames[i]))
+                std::exit(EXIT_SUCCESS);
+
+        int messagePipe[2];
+        if (pipe(messagePipe) != 0)
+            __testlib_fail("registerTestlibServer: can't create pipe");
+
+        std::fflush(stdout);
+        std::fflush(stderr);
+        pid_t pid = fork();
+        if (pid < 0)
+            __testlib_fail("registerTestlibServer: can't fork");
+
+        if (pid == 0) {
+            /* The checker reports to the message pipe, stdout is reserved for verdict lines. */
+            close(messagePipe[0]);
+            __testlib_redirectForked(messagePipe[1]);
+            // With TESTLIB_PROFILE the record of this test ends its reply line
+            __testlib_profile = __testlib_profile_t();
+
+            std::vector<char *> args(argv, argv + argc);
+            for (int i = 0; i < 3; i++)
+                args.push_back(const_cast<char *>(fileNames[i].c_str()));
+            registerTestlibCmd(int(args.size()), args.data());
+            return;
+        }
+
+        close(messagePipe[1]);
+        std::string message;
+        int exitCode = __testlib_collectForked(pid, messagePipe[0], message);
+
+        for (size_t i = 0; i < message.length(); i++)
+            if (message[i] == LF || message[i] == CR)
+                message[i] = SPACE;
+        while (!message.empty() && message[message.length() - 1] == SPACE)
+            message.erase(message.length() - 1);
+
+        std::fprintf(stdout, "%d %s\n", exitCode, message.c_str());
+        std::fflush(stdout);
+    }
+#endif
+}
+
 void registerTestlib(int argc, ...) {
     if (argc < 3 || argc > 5)
         quit(_fail, std::string("Program must be run with the following arguments: ") +
@@ -4963,7 +6977,7 @@ __attribute__ ((format (printf, 2, 3)))
 #endif
 inline void ensuref(bool cond, const char *format, ...) {
     if (!cond) {
-        FMT_TO_RESULT(format, format, message);
+        FMT_TO_MESSAGE(format, format, message);
         __testlib_ensure(cond, message);
     }
 }
@@ -5071,15 +7085,716 @@ inline std::string englishEnding(int x) {
     return "th";
 }
 
-template<typename _ForwardIterator, typename _Separator>
-#ifdef __GNUC__
-__attribute__((const))
-#endif
-std::string join(_ForwardIterator first, _ForwardIterator last, _Separator separator) {
-    std::stringstream ss;
-    bool repeated = false;
-    for (_ForwardIterator i = first; i != last; i++) {
-        if (repeated)
+/*
+ * Skips the equal tokens of a[i..sizeA) and b[j..sizeB) without tokenizing them: byte-identical
+ * parts and parts differing only in white-spaces are compared with SIMD. Stops before the first
+ * pair of different tokens or when one of the ranges ends (after white-spaces), i and j are left
+ * there. The ranges must start outside of tokens. Returns the number of skipped tokens.
+ */
+inline size_t __testlib_skipEqualBytes(const char *a, size_t sizeA, size_t &i,
+                                       const char *b, size_t sizeB, size_t &j) {
+    size_t startA = i;
+    while (true) {
+        size_t common = __testlib_commonPrefix(a + i, b + j, __testlib_min(sizeA - i, sizeB - j));
+        i += common;
+        j += common;
+
+        // Since the last white-space run both ranges went in lockstep, so a[i - 1] and b[j - 1]
+        // are equal or are both white-spaces (or i, j are the starts of the ranges).
+        bool inToken = i > startA && !isBlanks(a[i - 1]);
+        bool tokenEndA = i == sizeA || isBlanks(a[i]);
+        bool tokenEndB = j == sizeB || isBlanks(b[j]);
+
+        if (inToken && !(tokenEndA && tokenEndB)) {
+            // The current tokens differ: rewind both ranges to their starts.
+            size_t start = i;
+            while (start > startA && !isBlanks(a[start - 1]))
+                start--;
+            j -= i - start;
+            i = start;
+            break;
+        }
+
+        if (!inToken && !tokenEndA && !tokenEndB)
+            break;
+
+        while (i < sizeA && isBlanks(a[i]))
+            i++;
+        while (j < sizeB && isBlanks(b[j]))
+            j++;
+
+        if (i == sizeA || j == sizeB)
+            break;
+    }
+    return __testlib_countTokens(a + startA, i - startA);
+}
+
+/*
+ * Runs skip(a, sizeA, i, b, sizeB, j) of the __testlib_skipEqualBytes kind over the readers' spans
+ * of first and second and moves the streams past the skipped tokens. A span which doesn't end its
+ * stream is cut after its last white-space, so only whole tokens are compared; when the cut span of
+ * one stream is used up, the token cut by the end of its buffer is kept and the next part of the
+ * stream is appended to it (extendSpan), so a stream read from a pipe is compared buffer by buffer.
+ * Stops at the first pair of different tokens, at the end of one of the streams or when a reader
+ * can't extend its span. Returns the number of skipped tokens.
+ */
+template<typename F>
+inline size_t __testlib_skipEqualWindows(InStream &first, InStream &second, F &skip) {
+    size_t result = 0;
+    while (true) {
+        const char *a;
+        const char *b;
+        size_t sizeA, sizeB;
+        bool atEofA, atEofB;
+        if (!first.reader->getSpan(a, sizeA, atEofA) || !second.reader->getSpan(b, sizeB, atEofB))
+            break;
+
+        size_t endA = sizeA, endB = sizeB;
+        if (!atEofA)
+            while (endA > 0 && !isBlanks(a[endA - 1]))
+                endA--;
+        if (!atEofB)
+            while (endB > 0 && !isBlanks(b[endB - 1]))
+                endB--;
+
+        size_t i = 0, j = 0;
+        result += skip(a, endA, i, b, endB, j);
+        while (i < endA && isBlanks(a[i]))
+            i++;
+        while (j < endB && isBlanks(b[j]))
+            j++;
+        first.reader->skipSpan(i);
+        second.reader->skipSpan(j);
+
+        // Both have tokens left: they differ. A stream which has ended has no more tokens to skip.
+        if ((i < endA && j < endB) || (i == endA && atEofA) || (j == endB && atEofB))
+            break;
+        if ((i == endA && !first.reader->extendSpan()) || (j == endB && !second.reader->extendSpan()))
+            break;
+    }
+    return result;
+}
+
+/*
+ * Skips the common prefix of the token sequences of two streams without tokenizing them:
+ * byte-identical parts and parts differing only in white-spaces are compared with
+ * SIMD over the readers' buffers. Returns the number of skipped (equal) tokens; both
+ * streams are left before the first pair of different tokens (or at the end of one of
+ * the streams), so a usual token-by-token loop can continue and report the difference.
+ * Works in non-strict mode over mapped files, strings and buffered files (as ouf read from
+ * a pipe, compared buffer by buffer), otherwise skips nothing and returns 0.
+ *
+ * Example:
+ *     int n = skipEqualTokens(ans, ouf);
+ *     while (!ans.seekEof()) { n++; ... ans.readWord() ... ouf.readWord() ... }
+ */
+inline int skipEqualTokens(InStream &first, InStream &second) {
+    if (first.strict || second.strict || NULL == first.reader || NULL == second.reader)
+        return 0;
+
+    size_t (*skip)(const char *, size_t, size_t &, const char *, size_t, size_t &) = __testlib_skipEqualBytes;
+    int result = int(__testlib_skipEqualWindows(first, second, skip));
+    __testlib_profileSkippedTokens(first.mode, second.mode, result);
+    return result;
+}
+
+/*
+ * Compares the tokens of a[i..sizeA) and b[j..sizeB) pairwise, at most count pairs. Stops before
+ * the first pair for which equal() is false or when one of the ranges ends; i and j are left
+ * after the last equal pair. Returns the number of equal pairs.
+ */
+template<typename F>
+inline size_t __testlib_skipEqualTokens(const char *a, size_t sizeA, size_t &i,
+                                        const char *b, size_t sizeB, size_t &j, size_t count, F &equal) {
+    size_t result = 0;
+    while (result < count) {
+        size_t startA = i, startB = j;
+        while (startA < sizeA && isBlanks(a[startA]))
+            startA++;
+        while (startB < sizeB && isBlanks(b[startB]))
+            startB++;
+        if (startA == sizeA || startB == sizeB)
+            break;
+
+        size_t lengthA = __testlib_tokenLength(a + startA, sizeA - startA);
+        size_t lengthB = __testlib_tokenLength(b + startB, sizeB - startB);
+        if (!equal(a + startA, lengthA, b + startB, lengthB))
+            break;
+        i = startA + lengthA;
+        j = startB + lengthB;
+        result++;
+    }
+    return result;
+}
+
+/* Moves data position i past count tokens (or to the end of data). */
+inline void __testlib_skipTokens(const char *data, size_t size, size_t &i, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        while (i < size && isBlanks(data[i]))
+            i++;
+        i += __testlib_tokenLength(data + i, size - i);
+    }
+}
+
+#ifdef __TESTLIB_USE_THREADS
+#ifndef TESTLIB_PARALLEL_COMPARE_MIN_SIZE
+/* Outputs (answer and output together) at least this large are compared on several threads. */
+#   define TESTLIB_PARALLEL_COMPARE_MIN_SIZE (8 * 1024 * 1024)
+#endif
+
+#ifndef TESTLIB_PARALLEL_COMPARE_MAX_THREADS
+#   define TESTLIB_PARALLEL_COMPARE_MAX_THREADS 8
+#endif
+
+/* Runs task(0), ..., task(count - 1) on their own threads, inline if a thread can't be created. */
+template<typename F>
+inline void __testlib_parallelFor(size_t count, F &task) {
+    std::vector<std::thread> threads;
+    std::vector<size_t> inlineTasks;
+    for (size_t k = 1; k < count; k++) {
+        try {
+            threads.push_back(std::thread([&task, k]() { task(k); }));
+        } catch (const std::exception &) {
+            inlineTasks.push_back(k);
+        }
+    }
+    task(0);
+    for (size_t k = 0; k < inlineTasks.size(); k++)
+        task(inlineTasks[k]);
+    for (size_t k = 0; k < threads.size(); k++)
+        threads[k].join();
+}
+
+/*
+ * __testlib_skipEqualTokens over whole spans on several threads. Both spans are cut into chunks
+ * outside of tokens and the chunks' tokens are counted, so every thread knows the index of its
+ * first token in a and finds the token with the same index in b. Then each thread compares its
+ * range of tokens; the first chunk which stops early has the first pair of different tokens.
+ */
+template<typename F>
+inline size_t __testlib_parallelSkipEqualTokens(const char *a, size_t sizeA, size_t &i,
+                                                const char *b, size_t sizeB, size_t &j, F &equal) {
+    size_t chunkCount = __testlib_min(size_t(std::thread::hardware_concurrency()),
+                                      size_t(TESTLIB_PARALLEL_COMPARE_MAX_THREADS));
+    if (chunkCount < 2)
+        return __testlib_skipEqualTokens(a, sizeA, i, b, sizeB, j, size_t(-1), equal);
+
+    std::vector<size_t> boundA(chunkCount + 1, 0), boundB(chunkCount + 1, 0);
+    for (size_t k = 1; k < chunkCount; k++) {
+        size_t posA = __testlib_max(sizeA / chunkCount * k, boundA[k - 1]);
+        size_t posB = __testlib_max(sizeB / chunkCount * k, boundB[k - 1]);
+        boundA[k] = posA + __testlib_tokenLength(a + posA, sizeA - posA);
+        boundB[k] = posB + __testlib_tokenLength(b + posB, sizeB - posB);
+    }
+    boundA[chunkCount] = sizeA;
+    boundB[chunkCount] = sizeB;
+
+    std::vector<size_t> startA(chunkCount + 1, 0), startB(chunkCount + 1, 0);
+    struct CountTask {
+        const char *a, *b;
+        std::vector<size_t> &boundA, &boundB, &startA, &startB;
+
+        void operator()(size_t k) {
+            startA[k + 1] = __testlib_countTokens(a + boundA[k], boundA[k + 1] - boundA[k]);
+            startB[k + 1] = __testlib_countTokens(b + boundB[k], boundB[k + 1] - boundB[k]);
+        }
+    } countTask = {a, b, boundA, boundB, startA, startB};
+    __testlib_parallelFor(chunkCount, countTask);
+    for (size_t k = 0; k < chunkCount; k++) {
+        startA[k + 1] += startA[k];
+        startB[k + 1] += startB[k];
+    }
+    size_t tokensB = startB[chunkCount];
+
+    std::vector<size_t> endA(chunkCount), endB(chunkCount), equalCount(chunkCount);
+    std::vector<char> stopped(chunkCount, 0);
+    std::atomic<size_t> firstStopped(chunkCount);
+    struct CompareTask {
+        const char *a, *b;
+        size_t sizeA, sizeB, tokensB;
+        std::vector<size_t> &boundA, &boundB, &startA, &startB, &endA, &endB, &equalCount;
+        std::vector<char> &stopped;
+        std::atomic<size_t> &firstStopped;
+        F &equal;
+
+        void operator()(size_t k) {
+            size_t first = startA[k];
+            size_t count = startA[k + 1] - first;
+            size_t m = 0;
+            while (m + 1 < startB.size() - 1 && startB[m + 1] <= first)
+                m++;
+            size_t posA = boundA[k], posB = boundB[m];
+            __testlib_skipTokens(b, sizeB, posB, __testlib_min(first, tokensB) - startB[m]);
+
+            size_t result = 0, limit = first < tokensB ? __testlib_min(count, tokensB - first) : 0;
+            // Compared in blocks, so that a chunk after a found difference can stop early.
+            const size_t BLOCK = 4096;
+            while (result < limit && firstStopped.load(std::memory_order_relaxed) > k) {
+                size_t block = __testlib_min(BLOCK, limit - result);
+                size_t equalTokens = __testlib_skipEqualTokens(a, sizeA, posA, b, sizeB, posB, block, equal);
+                result += equalTokens;
+                if (equalTokens < block)
+                    break;
+            }
+
+            endA[k] = posA;
+            endB[k] = posB;
+            equalCount[k] = result;
+            if (result < count && firstStopped.load(std::memory_order_relaxed) > k) {
+                stopped[k] = 1;
+                size_t current = firstStopped.load();
+                while (current > k && !firstStopped.compare_exchange_weak(current, k));
+            }
+        }
+    } compareTask = {a, b, sizeA, sizeB, tokensB, boundA, boundB, startA, startB, endA, endB, equalCount,
+                     stopped, firstStopped, equal};
+    __testlib_parallelFor(chunkCount, compareTask);
+
+    size_t last = chunkCount - 1;
+    for (size_t k = 0; k < chunkCount; k++)
+        if (stopped[k]) {
+            last = k;
+            break;
+        }
+    i = endA[last];
+    j = endB[last];
+    return startA[last] + equalCount[last];
+}
+#endif
+
+/*
+ * As skipEqualTokens(first, second), but tokens a[0..lengthA) of first and b[0..lengthB) of second
+ * are equal when equal(a, lengthA, b, lengthB) is true. The streams are compared window by window
+ * as skipEqualTokens(first, second) does, so ouf read from a pipe is handled too. When both streams
+ * are whole in memory (mapped files, as under registerTestlibCmd) and together reach
+ * TESTLIB_PARALLEL_COMPARE_MIN_SIZE, they are compared on several threads instead, with the same
+ * result: equal() must be thread-safe and must not quit.
+ */
+template<typename F>
+inline int skipEqualTokens(InStream &first, InStream &second, F equal) {
+    if (first.strict || second.strict || NULL == first.reader || NULL == second.reader)
+        return 0;
+
+    int result;
+#ifdef __TESTLIB_USE_THREADS
+    const char *a;
+    const char *b;
+    size_t sizeA, sizeB;
+    bool atEofA, atEofB;
+    if (first.reader->getSpan(a, sizeA, atEofA) && atEofA && second.reader->getSpan(b, sizeB, atEofB) && atEofB
+            && sizeA + sizeB >= size_t(TESTLIB_PARALLEL_COMPARE_MIN_SIZE)) {
+        size_t i = 0, j = 0;
+        result = int(__testlib_parallelSkipEqualTokens(a, sizeA, i, b, sizeB, j, equal));
+        first.reader->skipSpan(i);
+        second.reader->skipSpan(j);
+    } else
+#endif
+    {
+        struct Skip {
+            F &equal;
+
+            size_t operator()(const char *a, size_t sizeA, size_t &i, const char *b, size_t sizeB, size_t &j) {
+                return __testlib_skipEqualTokens(a, sizeA, i, b, sizeB, j, size_t(-1), equal);
+            }
+        } skip = {equal};
+        result = int(__testlib_skipEqualWindows(first, second, skip));
+    }
+    __testlib_profileSkippedTokens(first.mode, second.mode, result);
+    return result;
+}
+
+/*
+ * As skipEqualTokens(first, second, equal) for sequences of doubles: equal(expected, found) gets
+ * the values of the tokens of first and second. Tokens which aren't doubles in the usual form
+ * ("-12", "3.25") stop the skipping, so readDouble() parses and reports them as usual.
+ *
+ * Example:
+ *     int n = skipEqualDoubles(ans, ouf, [](double j, double p) { return doubleCompare(j, p, 1E-6); });
+ */
+template<typename F>
+inline int skipEqualDoubles(InStream &first, InStream &second, F equal) {
+    return skipEqualTokens(first, second, [&equal](const char *a, size_t lengthA, const char *b, size_t lengthB) {
+        double expected, found;
+        return __testlib_tryParseNumber(a, lengthA, expected) && __testlib_tryParseNumber(b, lengthB, found)
+               && equal(expected, found);
+    });
+}
+
+/* The rcmp4 rule: doubles differ if both |e - f| > absEps and |e - f| / max(|e|, 1) > relEps. */
+inline bool __testlib_doublesDiffer(double expected, double found, double absEps, double relEps) {
+    double diff = std::fabs(expected - found);
+    double scale = std::fabs(expected);
+    if (scale < 1.0)
+        scale = 1.0;
+    return diff > absEps && diff / scale > relEps;
+}
+
+/* Returns the index of the first pair of expected[0..count), found[0..count) which differ, count if none. */
+inline size_t __testlib_firstDifferentDoubles(const double *expected, const double *found, size_t count,
+                                              double absEps, double relEps) {
+    size_t i = 0;
+#ifdef __TESTLIB_USE_AVX2
+    {
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d absLimit = _mm256_set1_pd(absEps);
+        const __m256d relLimit = _mm256_set1_pd(relEps);
+        for (; i + 4 <= count; i += 4) {
+            __m256d e = _mm256_loadu_pd(expected + i);
+            __m256d diff = _mm256_andnot_pd(signMask, _mm256_sub_pd(e, _mm256_loadu_pd(found + i)));
+            __m256d scale = _mm256_max_pd(_mm256_andnot_pd(signMask, e), one);
+            __m256d differ = _mm256_and_pd(_mm256_cmp_pd(diff, absLimit, _CMP_GT_OQ),
+                                           _mm256_cmp_pd(_mm256_div_pd(diff, scale), relLimit, _CMP_GT_OQ));
+            if (_mm256_movemask_pd(differ) != 0)
+                break;
+        }
+    }
+#endif
+#ifdef __TESTLIB_USE_SSE2
+    {
+        const __m128d signMask = _mm_set1_pd(-0.0);
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d absLimit = _mm_set1_pd(absEps);
+        const __m128d relLimit = _mm_set1_pd(relEps);
+        for (; i + 2 <= count; i += 2) {
+            __m128d e = _mm_loadu_pd(expected + i);
+            __m128d diff = _mm_andnot_pd(signMask, _mm_sub_pd(e, _mm_loadu_pd(found + i)));
+            __m128d scale = _mm_max_pd(_mm_andnot_pd(signMask, e), one);
+            __m128d differ = _mm_and_pd(_mm_cmpgt_pd(diff, absLimit),
+                                        _mm_cmpgt_pd(_mm_div_pd(diff, scale), relLimit));
+            if (_mm_movemask_pd(differ) != 0)
+                break;
+        }
+    }
+#endif
+    // The vector loops stop at the block of the first difference, the exact index is found here.
+    for (; i < count; i++)
+        if (__testlib_doublesDiffer(expected[i], found[i], absEps, relEps))
+            return i;
+    return count;
+}
+
+/*
+ * Parses the next pairs of doubles of first and second (at most count) into expected and found.
+ * Takes only whole tokens in the readers' spans which are doubles in the usual form, so it stops
+ * before anything readDouble() must check and report (or at the end of a stream).
+ * Returns the number of parsed pairs, the streams are moved past them.
+ */
+inline size_t __testlib_readDoublePairs(InStream &first, InStream &second, double *expected, double *found,
+                                        size_t count) {
+    const char *a;
+    const char *b;
+    size_t sizeA, sizeB;
+    bool atEofA, atEofB;
+    if (first.strict || second.strict || !first.reader->getSpan(a, sizeA, atEofA)
+            || !second.reader->getSpan(b, sizeB, atEofB))
+        return 0;
+
+    size_t result = 0, i = 0, j = 0;
+    while (result < count) {
+        size_t startA = i, startB = j;
+        while (startA < sizeA && isBlanks(a[startA]))
+            startA++;
+        while (startB < sizeB && isBlanks(b[startB]))
+            startB++;
+        if (startA == sizeA || startB == sizeB)
+            break;
+
+        size_t lengthA = __testlib_tokenLength(a + startA, sizeA - startA);
+        size_t lengthB = __testlib_tokenLength(b + startB, sizeB - startB);
+        if ((startA + lengthA == sizeA && !atEofA) || (startB + lengthB == sizeB && !atEofB)
+                || lengthA > first.maxTokenLength || lengthB > second.maxTokenLength
+                || !__testlib_tryParseNumber(a + startA, lengthA, expected[result])
+                || !__testlib_tryParseNumber(b + startB, lengthB, found[result]))
+            break;
+        i = startA + lengthA;
+        j = startB + lengthB;
+        result++;
+    }
+
+    first.reader->skipSpan(i);
+    second.reader->skipSpan(j);
+    return result;
+}
+
+/*
+ * Compares the sequences of doubles of expected (usually ans) and found (usually ouf) and quits:
+ * numbers differ if both |e - f| > absEps and |e - f| / max(|e|, 1) > relEps. Verdicts and
+ * messages are the ones of rcmp4. Numbers are parsed in blocks and each block is checked with
+ * SIMD.
+ *
+ * Example (rcmp6):
+ *     registerTestlibCmd(argc, argv);
+ *     compareDoubles(ans, ouf, 1E-6, 1E-6);
+ */
+NORETURN inline void compareDoubles(InStream &expected, InStream &found, double absEps, double relEps) {
+    const size_t BLOCK = 1024;
+    double expectedValues[BLOCK];
+    double foundValues[BLOCK];
+
+    int n = 0;
+    while (true) {
+        size_t count = __testlib_readDoublePairs(expected, found, expectedValues, foundValues, BLOCK);
+        size_t index = __testlib_firstDifferentDoubles(expectedValues, foundValues, count, absEps, relEps);
+        double j, p;
+        if (index < count) {
+            n += int(index) + 1;
+            j = expectedValues[index];
+            p = foundValues[index];
+        } else {
+            n += int(count);
+            if (count == BLOCK)
+                continue;
+
+            // A number readDouble() has to check, or the end of one of the streams.
+            if (expected.seekEof())
+                break;
+            n++;
+            j = expected.readDouble();
+            p = found.readDouble();
+            if (!__testlib_doublesDiffer(j, p, absEps, relEps))
+                continue;
+        }
+        quitf(_wa, "%d%s numbers differ - expected: '%.10f', found: '%.10f', error = '%.10f'",
+              n, englishEnding(n).c_str(), j, p, std::fabs(j - p));
+    }
+
+    quitf(_ok, "%d number(s)", n);
+}
+
+/*
+ * Ready comparison modes for checkers, selected at compile time:
+ *
+ *     testlib::compare<TokenPolicy, CasePolicy, NumberPolicy, TrailingPolicy>(ans, ouf);
+ *
+ * compares ans (expected) and ouf (found) and quits. The bundled checkers are
+ *     wcmp:      testlib::compare<testlib::Words, testlib::CaseSensitive, testlib::Strings, testlib::ReportTrailing>
+ *     icpc_diff: testlib::compare<testlib::Tokens, testlib::CaseSensitive, testlib::Strings, testlib::RejectTrailing>
+ *     rcmp4:     testlib::compare<testlib::Words, testlib::CaseSensitive, testlib::Doubles<4>, testlib::DefaultTrailing>
+ * and lcmp is testlib::compare<testlib::Lines, testlib::CaseSensitive, testlib::Strings, testlib::DefaultTrailing>.
+ */
+namespace testlib {
+/* Token policies: what is compared and how differences are reported. */
+
+/* White-space separated tokens, reported as wcmp does. */
+struct Words {
+    static const bool LINES = false;
+
+    static const char *unit() {
+        return "word";
+    }
+
+    NORETURN static void differ(int n, const std::string &expected, const std::string &found) {
+        quitf(_wa, "%d%s words differ - expected: '%s', found: '%s'", n, englishEnding(n).c_str(),
+              compress(expected).c_str(), compress(found).c_str());
+    }
+
+    NORETURN static void ok(int n) {
+        if (n == 0)
+            quitf(_ok, "no tokens");
+        quitf(_ok, "%d token(s)", n);
+    }
+};
+
+/* White-space separated tokens, reported as icpc_diff does. */
+struct Tokens {
+    static const bool LINES = false;
+
+    static const char *unit() {
+        return "token";
+    }
+
+    NORETURN static void differ(int n, const std::string &expected, const std::string &found) {
+        quitf(_wa, "%d%s token differs: expected %s, found %s", n, englishEnding(n).c_str(),
+              compress(expected).c_str(), compress(found).c_str());
+    }
+
+    NORETURN static void ok(int n) {
+        quitf(_ok, "%d token%s", n, n == 1 ? "" : "s");
+    }
+};
+
+/* Lines, each compared as a sequence of white-space separated words (as lcmp does). */
+struct Lines {
+    static const bool LINES = true;
+};
+
+/* Case policies: how two tokens are compared as strings. */
+
+struct CaseSensitive {
+    static const bool BYTES = true;
+
+    static bool equal(const char *a, size_t lengthA, const char *b, size_t lengthB) {
+        return lengthA == lengthB && std::memcmp(a, b, lengthA) == 0;
+    }
+};
+
+/* Latin letters are compared ignoring their case. */
+struct CaseInsensitive {
+    static const bool BYTES = false;
+
+    static bool equal(const char *a, size_t lengthA, const char *b, size_t lengthB) {
+        if (lengthA != lengthB)
+            return false;
+        for (size_t i = 0; i < lengthA; i++)
+            if (a[i] != b[i] && std::tolower((unsigned char) a[i]) != std::tolower((unsigned char) b[i]))
+                return false;
+        return true;
+    }
+};
+
+/* Number policies: whether tokens are compared as strings or as numbers. */
+
+struct Strings {
+    static const bool STRINGS = true;
+};
+
+/* Doubles with max absolute or relative error 1E-Digits (rcmp4 is Doubles<4>), see compareDoubles. */
+template<int Digits>
+struct Doubles {
+    static const bool STRINGS = false;
+
+    static double eps() {
+        double scale = 1.0;
+        for (int i = 0; i < Digits; i++)
+            scale *= 10.0;
+        return 1.0 / scale;
+    }
+};
+
+/* Trailing policies: what if one of the outputs has fewer tokens. */
+
+/* Missing and extra tokens are wrong answers showing the next token (as wcmp does). */
+struct ReportTrailing {
+    static const bool REPORT_MISSING = true;
+
+    template<typename TokenPolicy>
+    static void finish(InStream &expected, InStream &found, int) {
+        if (!expected.seekEof())
+            quitf(_wa, "expected %d more %s(s); next expected: '%s'", 1, TokenPolicy::unit(),
+                  compress(expected.readWord()).c_str());
+        if (!found.seekEof())
+            quitf(_wa, "participant produced %d more %s(s); next found: '%s'", 1, TokenPolicy::unit(),
+                  compress(found.readWord()).c_str());
+    }
+};
+
+/* Missing tokens are an unexpected end of file, extra ones are a wrong answer (as icpc_diff does). */
+struct RejectTrailing {
+    static const bool REPORT_MISSING = false;
+
+    template<typename TokenPolicy>
+    static void finish(InStream &, InStream &found, int n) {
+        if (!found.seekEof())
+            quitf(_wa, "participant produced extra trailing output after %s %d", TokenPolicy::unit(), n);
+    }
+};
+
+/* Missing tokens are an unexpected end of file, extra ones are left to the check of quitf(_ok) (as rcmp4 does). */
+struct DefaultTrailing {
+    static const bool REPORT_MISSING = false;
+
+    template<typename TokenPolicy>
+    static void finish(InStream &, InStream &, int) {
+        // No operations.
+    }
+};
+}
+
+/* Token sequences compared as strings; the modes with numbers and lines are specializations. */
+template<typename TokenPolicy, typename CasePolicy, typename NumberPolicy, typename TrailingPolicy>
+struct __testlib_compare {
+    static_assert(NumberPolicy::STRINGS, "testlib::Doubles is supported only with testlib::DefaultTrailing");
+    static_assert(!TokenPolicy::LINES, "testlib::Lines is supported only with testlib::Strings and testlib::DefaultTrailing");
+
+    NORETURN static void run(InStream &expected, InStream &found) {
+        int n = CasePolicy::BYTES ? skipEqualTokens(expected, found) : skipEqualTokens(expected, found, CasePolicy::equal);
+
+        std::string j, p;
+        while (!expected.seekEof() && !(TrailingPolicy::REPORT_MISSING && found.seekEof())) {
+            n++;
+            expected.readWordTo(j);
+            found.readWordTo(p);
+            if (!CasePolicy::equal(j.data(), j.length(), p.data(), p.length()))
+                TokenPolicy::differ(n, j, p);
+        }
+
+        TrailingPolicy::template finish<TokenPolicy>(expected, found, n);
+        TokenPolicy::ok(n);
+    }
+};
+
+template<typename TokenPolicy, typename CasePolicy, int Digits>
+struct __testlib_compare<TokenPolicy, CasePolicy, testlib::Doubles<Digits>, testlib::DefaultTrailing> {
+    NORETURN static void run(InStream &expected, InStream &found) {
+        compareDoubles(expected, found, testlib::Doubles<Digits>::eps(), testlib::Doubles<Digits>::eps());
+    }
+};
+
+template<typename CasePolicy>
+struct __testlib_compare<testlib::Lines, CasePolicy, testlib::Strings, testlib::DefaultTrailing> {
+    static std::vector<std::string> words(const std::string &line) {
+        std::vector<std::string> result;
+        for (size_t i = 0; i < line.length();) {
+            if (isBlanks(line[i])) {
+                i++;
+                continue;
+            }
+            size_t length = __testlib_tokenLength(line.data() + i, line.length() - i);
+            result.push_back(line.substr(i, length));
+            i += length;
+        }
+        return result;
+    }
+
+    static bool equal(const std::string &expected, const std::string &found) {
+        std::vector<std::string> a = words(expected), b = words(found);
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (!CasePolicy::equal(a[i].data(), a[i].length(), b[i].data(), b[i].length()))
+                return false;
+        return true;
+    }
+
+    NORETURN static void run(InStream &expected, InStream &found) {
+        std::string firstLine;
+        int n = 0;
+        while (!expected.eof()) {
+            std::string j = expected.readString();
+            if (j.empty() && expected.eof())
+                break;
+            std::string p = found.readString();
+            n++;
+            if (n == 1)
+                firstLine = j;
+            if (!equal(j, p))
+                quitf(_wa, "%d%s lines differ - expected: '%s', found: '%s'", n, englishEnding(n).c_str(),
+                      compress(j).c_str(), compress(p).c_str());
+        }
+
+        if (n == 1)
+            quitf(_ok, "single line: '%s'", compress(firstLine).c_str());
+        quitf(_ok, "%d lines", n);
+    }
+};
+
+namespace testlib {
+template<typename TokenPolicy, typename CasePolicy, typename NumberPolicy, typename TrailingPolicy>
+NORETURN inline void compare(InStream &expected, InStream &found) {
+    __testlib_compare<TokenPolicy, CasePolicy, NumberPolicy, TrailingPolicy>::run(expected, found);
+}
+}
+
+template<typename _ForwardIterator, typename _Separator>
+#ifdef __GNUC__
+__attribute__((const))
+#endif
+std::string join(_ForwardIterator first, _ForwardIterator last, _Separator separator) {
+    std::stringstream ss;
+    bool repeated = false;
+    for (_ForwardIterator i = first; i != last; i++) {
+        if (repeated)
             ss << separator;
         else
             repeated = true;
@@ -5232,7 +7947,7 @@ template<typename T>
 __attribute__ ((format (printf, 4, 5)))
 #endif
 NORETURN void expectedButFound(TResult result, T expected, T found, const char *prependFormat = "", ...) {
-    FMT_TO_RESULT(prependFormat, prependFormat, prepend);
+    FMT_TO_MESSAGE(prependFormat, prependFormat, prepend);
     std::string expectedString = vtos(expected);
     std::string foundString = vtos(found);
     __testlib_expectedButFound(result, expectedString, foundString, prepend.c_str());
@@ -5244,7 +7959,7 @@ __attribute__ ((format (printf, 4, 5)))
 #endif
 NORETURN void
 expectedButFound<std::string>(TResult result, std::string expected, std::string found, const char *prependFormat, ...) {
-    FMT_TO_RESULT(prependFormat, prependFormat, prepend);
+    FMT_TO_MESSAGE(prependFormat, prependFormat, prepend);
     __testlib_expectedButFound(result, expected, found, prepend.c_str());
 }
 
@@ -5253,7 +7968,7 @@ template<>
 __attribute__ ((format (printf, 4, 5)))
 #endif
 NORETURN void expectedButFound<double>(TResult result, double expected, double found, const char *prependFormat, ...) {
-    FMT_TO_RESULT(prependFormat, prependFormat, prepend);
+    FMT_TO_MESSAGE(prependFormat, prependFormat, prepend);
     std::string expectedString = removeDoubleTrailingZeroes(testlib_format_("%.12f", expected));
     std::string foundString = removeDoubleTrailingZeroes(testlib_format_("%.12f", found));
     __testlib_expectedButFound(result, expectedString, foundString, prepend.c_str());
@@ -5266,7 +7981,7 @@ __attribute__ ((format (printf, 4, 5)))
 NORETURN void
 expectedButFound<const char *>(TResult result, const char *expected, const char *found, const char *prependFormat,
                                ...) {
-    FMT_TO_RESULT(prependFormat, prependFormat, prepend);
+    FMT_TO_MESSAGE(prependFormat, prependFormat, prepend);
     __testlib_expectedButFound(result, std::string(expected), std::string(found), prepend.c_str());
 }
 
@@ -5275,7 +7990,7 @@ template<>
 __attribute__ ((format (printf, 4, 5)))
 #endif
 NORETURN void expectedButFound<float>(TResult result, float expected, float found, const char *prependFormat, ...) {
-    FMT_TO_RESULT(prependFormat, prependFormat, prepend);
+    FMT_TO_MESSAGE(prependFormat, prependFormat, prepend);
     __testlib_expectedButFound(result, double(expected), double(found), prepend.c_str());
 }
 
@@ -5285,10 +8000,218 @@ __attribute__ ((format (printf, 4, 5)))
 #endif
 NORETURN void
 expectedButFound<long double>(TResult result, long double expected, long double found, const char *prependFormat, ...) {
-    FMT_TO_RESULT(prependFormat, prependFormat, prepend);
+    FMT_TO_MESSAGE(prependFormat, prependFormat, prepend);
     __testlib_expectedButFound(result, double(expected), double(found), prepend.c_str());
 }
 
+/*
+ * Buffered writer to std::cout for generators producing large tests:
+ *
+ *     fastout << n << '\n';
+ *     fastout.writeRange(a.begin(), a.end()) << '\n';
+ *
+ * writeRange separates elements by a space (or the given separator). Floating values
+ * are written as std::cout does by default ("%g"), or in fixed notation after
+ * fastout.setPrecision(digits). The buffer goes to std::cout when it is full, on
+ * fastout.flush() and at exit, so call fastout.flush() before writing to std::cout
+ * or stdout directly. An interactor flushes fastout, std::cout and stdout by itself
+ * whenever it waits for the participant in ouf, so a query costs one write(2) however
+ * it was printed. println() writes through fastout and keeps the order with std::cout.
+ */
+class fastout_t {
+public:
+    fastout_t() : _size(0), _precision(-1) {
+    }
+
+    ~fastout_t() {
+        flush();
+    }
+
+    /* Sets the number of digits after the decimal point for floating values, -1 returns to "%g". */
+    void setPrecision(int digits) {
+        if (digits > 100)
+            __testlib_fail("fastout_t::setPrecision(int digits): digits should be at most 100");
+        _precision = digits < 0 ? -1 : digits;
+    }
+
+    /* Passes the buffered output to std::cout without flushing it. */
+    void push() {
+        if (_size > 0) {
+            std::cout.write(_buffer, _size);
+            _size = 0;
+        }
+    }
+
+    void flush() {
+        push();
+        std::cout.flush();
+    }
+
+    fastout_t &write(const char *s, size_t length) {
+        if (length > CAPACITY - _size) {
+            push();
+            if (length > CAPACITY) {
+                std::cout.write(s, length);
+                return *this;
+            }
+        }
+        std::memcpy(_buffer + _size, s, length);
+        _size += length;
+        return *this;
+    }
+
+    fastout_t &writeSigned(long long value) {
+        reserve(24);
+        unsigned long long magnitude = (unsigned long long) value;
+        if (value < 0) {
+            _buffer[_size++] = '-';
+            magnitude = 0ULL - magnitude;
+        }
+        return writeDigits(magnitude);
+    }
+
+    fastout_t &writeUnsigned(unsigned long long value) {
+        reserve(24);
+        return writeDigits(value);
+    }
+
+    /* Writes value like printf("%.*f") if fixed or printf("%.*g") otherwise. */
+    template<typename T>
+    fastout_t &writeReal(T value, bool fixed, int precision) {
+        char buffer[512];
+        int length;
+#ifdef __TESTLIB_HAS_FROM_CHARS_DOUBLE
+        std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                fixed ? std::chars_format::fixed : std::chars_format::general, precision);
+        length = result.ec == std::errc() ? int(result.ptr - buffer) : -1;
+#else
+        length = std::snprintf(buffer, sizeof(buffer), fixed ? "%.*Lf" : "%.*Lg", precision, (long double) value);
+#endif
+        if (length < 0 || length >= int(sizeof(buffer)))
+            __testlib_fail("fastout_t: can't format floating value");
+        return write(buffer, length);
+    }
+
+    template<typename Iter>
+    fastout_t &writeRange(Iter begin, Iter end, char separator = ' ') {
+        for (Iter i = begin; i != end; i++) {
+            if (i != begin)
+                *this << separator;
+            *this << *i;
+        }
+        return *this;
+    }
+
+    template<typename Container>
+    fastout_t &writeRange(const Container &c, char separator = ' ') {
+        return writeRange(c.begin(), c.end(), separator);
+    }
+
+    /* Writes the edges "u v" one per line, vertex v as first + v (edges of rnd.tree() are 0-based). */
+    template<typename T>
+    fastout_t &writeEdges(const std::vector<std::pair<T, T> > &edges, T first = 1) {
+        for (size_t i = 0; i < edges.size(); i++)
+            *this << T(edges[i].first + first) << ' ' << T(edges[i].second + first) << '\n';
+        return *this;
+    }
+
+    fastout_t &operator<<(char c) {
+        reserve(1);
+        _buffer[_size++] = c;
+        return *this;
+    }
+
+    fastout_t &operator<<(signed char c) {
+        return *this << char(c);
+    }
+
+    fastout_t &operator<<(unsigned char c) {
+        return *this << char(c);
+    }
+
+    fastout_t &operator<<(bool b) {
+        return *this << char(b ? '1' : '0');
+    }
+
+    fastout_t &operator<<(const char *s) {
+        return write(s, std::strlen(s));
+    }
+
+    fastout_t &operator<<(const std::string &s) {
+        return write(s.data(), s.length());
+    }
+
+    fastout_t &operator<<(short value) {
+        return writeSigned(value);
+    }
+
+    fastout_t &operator<<(unsigned short value) {
+        return writeUnsigned(value);
+    }
+
+    fastout_t &operator<<(int value) {
+        return writeSigned(value);
+    }
+
+    fastout_t &operator<<(unsigned int value) {
+        return writeUnsigned(value);
+    }
+
+    fastout_t &operator<<(long value) {
+        return writeSigned(value);
+    }
+
+    fastout_t &operator<<(unsigned long value) {
+        return writeUnsigned(value);
+    }
+
+    fastout_t &operator<<(long long value) {
+        return writeSigned(value);
+    }
+
+    fastout_t &operator<<(unsigned long long value) {
+        return writeUnsigned(value);
+    }
+
+    fastout_t &operator<<(float value) {
+        return writeReal(value, _precision >= 0, _precision >= 0 ? _precision : 6);
+    }
+
+    fastout_t &operator<<(double value) {
+        return writeReal(value, _precision >= 0, _precision >= 0 ? _precision : 6);
+    }
+
+    fastout_t &operator<<(long double value) {
+        return writeReal(value, _precision >= 0, _precision >= 0 ? _precision : 6);
+    }
+
+private:
+    static const size_t CAPACITY = 1 << 16;
+
+    char _buffer[CAPACITY];
+    size_t _size;
+    int _precision;
+
+    void reserve(size_t length) {
+        if (length > CAPACITY - _size)
+            push();
+    }
+
+    fastout_t &writeDigits(unsigned long long value) {
+        char digits[20];
+        int length = 0;
+        do {
+            digits[length++] = char('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (length > 0)
+            _buffer[_size++] = digits[--length];
+        return *this;
+    }
+};
+
+fastout_t fastout;
+
 #if __cplusplus > 199711L || defined(_MSC_VER)
 template<typename T>
 struct is_iterable {
@@ -5310,11 +8233,88 @@ struct __testlib_enable_if<true, T> {
     typedef T type;
 };
 
+/* Whether std::cout would write numbers the same way as fastout (no hex, showpos, setw and so on). */
+inline bool __testlib_coutIsPlain() {
+    return (std::cout.flags() & ~(std::ios_base::floatfield | std::ios_base::skipws)) == std::ios_base::dec
+           && std::cout.width() == 0;
+}
+
+/* Writes t as std::cout << t does, through fastout where possible. */
 template<typename T>
-typename __testlib_enable_if<!is_iterable<T>::value, void>::type __testlib_print_one(const T &t) {
+void __testlib_print_value(const T &t) {
+    fastout.push();
     std::cout << t;
 }
 
+template<typename T>
+void __testlib_print_integer(T t) {
+    if (__testlib_coutIsPlain())
+        fastout << t;
+    else
+        __testlib_print_value<T>(t);
+}
+
+template<typename T>
+void __testlib_print_real(T t) {
+    std::ios_base::fmtflags floatfield = std::cout.flags() & std::ios_base::floatfield;
+    if (__testlib_coutIsPlain() && (floatfield == std::ios_base::fixed || floatfield == std::ios_base::fmtflags(0)))
+        fastout.writeReal(t, floatfield == std::ios_base::fixed, int(std::cout.precision()));
+    else
+        __testlib_print_value<T>(t);
+}
+
+inline void __testlib_print_value(short t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(unsigned short t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(int t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(unsigned int t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(long t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(unsigned long t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(long long t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(unsigned long long t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(bool t) { __testlib_print_integer(t); }
+inline void __testlib_print_value(float t) { __testlib_print_real(t); }
+inline void __testlib_print_value(double t) { __testlib_print_real(t); }
+inline void __testlib_print_value(long double t) { __testlib_print_real(t); }
+
+inline void __testlib_print_value(char t) {
+    if (std::cout.width() == 0)
+        fastout << t;
+    else
+        __testlib_print_value<char>(t);
+}
+
+inline void __testlib_print_value(const char *t) {
+    if (std::cout.width() == 0)
+        fastout << t;
+    else
+        __testlib_print_value<const char *>(t);
+}
+
+inline void __testlib_print_value(const std::string &t) {
+    if (std::cout.width() == 0)
+        fastout << t;
+    else
+        __testlib_print_value<std::string>(t);
+}
+
+/* Ends a println line, checkers and validators still flush it like std::endl (interactors flush on reading ouf). */
+inline void __testlib_println_end() {
+    fastout << '\n';
+    fastout.push();
+    if (testlibMode != _generator && testlibMode != _interactor)
+        std::cout.flush();
+}
+
+static void __testlib_flushInteraction() {
+    fastout.flush();
+    std::fflush(stdout);
+}
+
+template<typename T>
+typename __testlib_enable_if<!is_iterable<T>::value, void>::type __testlib_print_one(const T &t) {
+    __testlib_print_value(t);
+}
+
 template<typename T>
 typename __testlib_enable_if<is_iterable<T>::value, void>::type __testlib_print_one(const T &t) {
     bool first = true;
@@ -5322,15 +8322,15 @@ typename __testlib_enable_if<is_iterable<T>::value, void>::type __testlib_print_
         if (first)
             first = false;
         else
-            std::cout << " ";
-        std::cout << *i;
+            __testlib_print_value(' ');
+        __testlib_print_value(*i);
     }
 }
 
 template<>
 typename __testlib_enable_if<is_iterable<std::string>::value, void>::type
 __testlib_print_one<std::string>(const std::string &t) {
-    std::cout << t;
+    __testlib_print_value(t);
 }
 
 template<typename A, typename B>
@@ -5340,10 +8340,10 @@ void __println_range(A begin, B end) {
         if (first)
             first = false;
         else
-            std::cout << " ";
+            __testlib_print_value(' ');
         __testlib_print_one(*i);
     }
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<class T, class Enable = void>
@@ -5371,9 +8371,9 @@ struct is_iterator<T, typename __testlib_enable_if<std::is_array<T>::value>::typ
 template<typename A, typename B>
 typename __testlib_enable_if<!is_iterator<B>::value, void>::type println(const A &a, const B &b) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename A, typename B>
@@ -5389,85 +8389,85 @@ void println(const A *a, const A *b) {
 template<>
 void println<char>(const char *a, const char *b) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename T>
 void println(const T &x) {
     __testlib_print_one(x);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename A, typename B, typename C>
 void println(const A &a, const B &b, const C &c) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(c);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename A, typename B, typename C, typename D>
 void println(const A &a, const B &b, const C &c, const D &d) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(c);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(d);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename A, typename B, typename C, typename D, typename E>
 void println(const A &a, const B &b, const C &c, const D &d, const E &e) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(c);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(d);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(e);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename A, typename B, typename C, typename D, typename E, typename F>
 void println(const A &a, const B &b, const C &c, const D &d, const E &e, const F &f) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(c);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(d);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(e);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(f);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 template<typename A, typename B, typename C, typename D, typename E, typename F, typename G>
 void println(const A &a, const B &b, const C &c, const D &d, const E &e, const F &f, const G &g) {
     __testlib_print_one(a);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(b);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(c);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(d);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(e);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(f);
-    std::cout << " ";
+    __testlib_print_value(' ');
     __testlib_print_one(g);
-    std::cout << std::endl;
+    __testlib_println_end();
 }
 
 /* opts */